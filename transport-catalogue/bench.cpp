@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+#include "bench_utils.h"
+#include "city_generator.h"
+#include "json.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+// Нагрузочный прогон на синтетическом городе.
+// Usage:
+//   bench [options]                    — все этапы в одном процессе, отчёт в stdout
+//   bench generate <prefix> [options]  — пишет <prefix>.make.json и <prefix>.proc.json
+//                                        для обычных make_base и process_requests
+// Options:
+//   --stops N --buses N --route-length N --requests N --seed N
+//   --mix Bus:2,Stop:2,Route:4,Nearby:1,Map:0,...  — доли типов stat_requests
+//   --router all_pairs|dijkstra|contraction_hierarchy --graph stop_pairs|transfer
+//   --format protobuf|mapped --storage full|graph|settings --threads N --file path
+
+using namespace std;
+using namespace std::literals;
+using bench::CityConfig;
+using bench::CityGenerator;
+
+namespace {
+
+vector<pair<string, int>> ParseMix(string_view text) {
+    vector<pair<string, int>> mix;
+
+    while (!text.empty()) {
+        const size_t comma = min(text.find(','), text.size());
+        const string_view item = text.substr(0, comma);
+        const size_t colon = item.find(':');
+
+        if (colon == string_view::npos) {
+            throw invalid_argument("mix item should look like Type:weight"s);
+        }
+
+        mix.emplace_back(string(item.substr(0, colon)), stoi(string(item.substr(colon + 1))));
+        text.remove_prefix(min(comma + 1, text.size()));
+    }
+
+    return mix;
+}
+
+CityConfig ParseConfig(int argc, char* argv[], int first) {
+    CityConfig config;
+
+    for (int i = first; i < argc; i += 2) {
+        const string_view option(argv[i]);
+
+        if (i + 1 >= argc) {
+            throw invalid_argument("No value for "s + argv[i]);
+        }
+        const string value(argv[i + 1]);
+
+        if (option == "--stops"sv) {
+            config.stops = stoi(value);
+        } else if (option == "--buses"sv) {
+            config.buses = stoi(value);
+        } else if (option == "--route-length"sv) {
+            config.route_length = stoi(value);
+        } else if (option == "--requests"sv) {
+            config.requests = stoi(value);
+        } else if (option == "--seed"sv) {
+            config.seed = static_cast<unsigned>(stoul(value));
+        } else if (option == "--mix"sv) {
+            config.mix = ParseMix(value);
+        } else if (option == "--router"sv) {
+            config.router_mode = value;
+        } else if (option == "--graph"sv) {
+            config.graph_model = value;
+        } else if (option == "--format"sv) {
+            config.format = value;
+        } else if (option == "--storage"sv) {
+            config.storage = value;
+        } else if (option == "--threads"sv) {
+            config.threads = stoi(value);
+        } else if (option == "--file"sv) {
+            config.file = value;
+        } else {
+            throw invalid_argument("Unknown option "s + argv[i]);
+        }
+    }
+
+    if (config.stops < 2 || config.buses < 1 || config.route_length < 2) {
+        throw invalid_argument("Need at least 2 stops, 1 bus and 2 stops per route"s);
+    }
+
+    return config;
+}
+
+// Пиковый объём резидентной памяти процесса с его запуска, в мегабайтах
+double GetPeakRssMb() {
+#ifdef __unix__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // В Linux ru_maxrss — в килобайтах
+    return usage.ru_maxrss / 1024.0;
+#else
+    return 0;
+#endif
+}
+
+struct PhaseResult {
+    string name;
+    double seconds = 0;
+    double items = 0;
+    string_view unit;
+    double peak_rss_mb = 0;
+};
+
+class Report {
+public:
+    template <typename Function>
+    void Measure(string name, string_view unit, Function function) {
+        const auto start = chrono::steady_clock::now();
+        const double items = function();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        phases_.push_back({move(name), elapsed.count(), items, unit, GetPeakRssMb()});
+    }
+
+    void Print(ostream& out) const {
+        out << left << setw(24) << "phase"sv << right << setw(12) << "time, ms"sv << setw(14) << "items"sv
+            << setw(16) << "throughput"sv << "  "sv << setw(12) << left << "unit"sv
+            << right << setw(14) << "peak RSS, MB"sv << '\n';
+
+        out << fixed << setprecision(2);
+
+        for (const auto& phase : phases_) {
+            out << left << setw(24) << phase.name << right << setw(12) << phase.seconds * 1000
+                << setw(14) << phase.items
+                << setw(16) << (phase.seconds > 0 ? phase.items / phase.seconds : 0)
+                << "  "sv << setw(12) << left << phase.unit
+                << right << setw(14) << phase.peak_rss_mb << '\n';
+        }
+
+        out << defaultfloat;
+    }
+
+private:
+    vector<PhaseResult> phases_;
+};
+
+double ToMegabytes(size_t bytes) {
+    return static_cast<double>(bytes) / (1 << 20);
+}
+
+int RunBenchmark(const CityConfig& config) {
+    using namespace transport;
+
+    CityGenerator city(config);
+
+    ostringstream make_text;
+    city.WriteMakeBase(make_text);
+    ostringstream process_text;
+    city.WriteProcessRequests(process_text);
+
+    cout << "city: "sv << config.stops << " stops, "sv << config.buses << " buses of "sv
+         << config.route_length << " stops, "sv << config.requests << " stat_requests, router "sv
+         << config.router_mode << '/' << config.graph_model << ", base "sv << config.format
+         << '/' << config.storage << ", threads "sv << config.threads << "\n\n"sv;
+
+    Report report;
+
+    const string make_string = make_text.str();
+    optional<JsonReader> reader;
+
+    report.Measure("json parse"s, "MB/s"sv, [&] {
+        istringstream input(make_string);
+        reader.emplace(input);
+        return ToMegabytes(make_string.size());
+    });
+
+    TransportCatalogue catalogue;
+
+    report.Measure("FillCatalogue"s, "objects/s"sv, [&] {
+        reader->FillCatalogue(catalogue);
+        return static_cast<double>(catalogue.GetStopsSize() + catalogue.GetBusesSize());
+    });
+
+    report.Measure("router build"s, "edges/s"sv, [&] {
+        route::TransportRouter router(catalogue, reader->GetRouteSettings());
+        router.SetThreadsCount(config.threads);
+        router.InitRouter();
+        return static_cast<double>(router.GetGraph().GetEdgeCount());
+    });
+
+    const serialize::Settings settings = reader->GetSerializeSettings();
+
+    report.Measure("serialize"s, "MB/s"sv, [&] {
+        RequestHandler handler(catalogue);
+        handler.Serialize(settings, reader->GetRenderSettings(), reader->GetRouteSettingsOpt());
+        return ToMegabytes(filesystem::file_size(settings.file));
+    });
+
+    TransportCatalogue loaded_catalogue;
+    RequestHandler handler(loaded_catalogue);
+
+    report.Measure("deserialize"s, "MB/s"sv, [&] {
+        handler.Deserialize(settings);
+        return ToMegabytes(filesystem::file_size(settings.file));
+    });
+
+    // Запросы разных типов считаются отдельно, в порядке генерации
+    istringstream process_input(process_text.str());
+    const json::Document process_doc = json::Load(process_input);
+
+    map<string, json::Array> requests_by_type;
+    for (const auto& request : process_doc.GetRoot().AsDict().at("stat_requests"s).AsArray()) {
+        requests_by_type[request.AsDict().at("type"s).AsString()].push_back(request);
+    }
+
+    bench::NullBuffer null_buffer;
+    ostream null_output(&null_buffer);
+
+    // Ленивая подготовка маршрутизатора, карты и индекса не входит в замеры
+    for (const auto& [type, requests] : requests_by_type) {
+        handler.PrintJsonResponse(json::Array{requests.front()}, null_output);
+    }
+
+    for (const auto& [type, requests] : requests_by_type) {
+        report.Measure("request "s + type, "req/s"sv, [&, &requests = requests] {
+            handler.PrintJsonResponse(requests, null_output);
+            return static_cast<double>(requests.size());
+        });
+    }
+
+    report.Print(cout);
+
+    error_code ignored;
+    filesystem::remove(settings.file, ignored);
+
+    return 0;
+}
+
+int Generate(const string& prefix, const CityConfig& config) {
+    CityGenerator city(config);
+
+    ofstream make_out(prefix + ".make.json"s);
+    city.WriteMakeBase(make_out);
+
+    ofstream process_out(prefix + ".proc.json"s);
+    city.WriteProcessRequests(process_out);
+
+    if (!make_out || !process_out) {
+        cerr << "Can't write "sv << prefix << ".*.json"sv << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        if (argc > 2 && argv[1] == "generate"sv) {
+            return Generate(argv[2], ParseConfig(argc, argv, 3));
+        }
+        return RunBenchmark(ParseConfig(argc, argv, 1));
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
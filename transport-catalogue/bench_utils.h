@@ -0,0 +1,30 @@
+#pragma once
+
+#include <streambuf>
+
+namespace bench {
+
+// Буфер потока, который только отбрасывает вывод: замеры не зависят
+// от скорости записи в файл или терминал
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Не даёт компилятору выбросить вычисление value как неиспользуемое
+template <typename T>
+void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile T* sink = &value;
+    (void)sink;
+#endif
+}
+
+} // namespace bench
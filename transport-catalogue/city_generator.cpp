@@ -0,0 +1,225 @@
+#include "city_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+using namespace std::literals;
+
+namespace bench {
+
+string StopName(int index) {
+    return "Stop "s + to_string(index);
+}
+
+string BusName(int index) {
+    return "Bus "s + to_string(index);
+}
+
+CityGenerator::CityGenerator(const CityConfig& config)
+    : config_(config)
+    , generator_(config.seed)
+    , side_(static_cast<int>(ceil(sqrt(config.stops)))) {
+
+    uniform_real_distribution<double> jitter(-0.3, 0.3);
+
+    for (int i = 0; i < config_.stops; ++i) {
+        const int row = i / side_;
+        const int col = i % side_;
+        stops_.push_back({BASE_LAT + (row + jitter(generator_)) * CELL_DEGREES,
+                          BASE_LNG + (col + jitter(generator_)) * CELL_DEGREES});
+    }
+
+    for (int i = 0; i < config_.buses; ++i) {
+        routes_.push_back(MakeRoute(i % 2 == 0));
+    }
+}
+
+void CityGenerator::WriteMakeBase(ostream& out) const {
+    out.precision(10);
+    json::Writer writer(out);
+
+    writer.StartDict().Key("base_requests"sv).StartArray();
+
+    for (int i = 0; i < config_.stops; ++i) {
+        writer.StartDict()
+            .Key("type"sv).Value("Stop"sv)
+            .Key("name"sv).Value(StopName(i))
+            .Key("latitude"sv).Value(stops_[i].lat)
+            .Key("longitude"sv).Value(stops_[i].lng)
+            .Key("road_distances"sv).StartDict();
+
+        for (auto it = distances_.lower_bound({i, 0}); it != distances_.end() && it->first.first == i; ++it) {
+            writer.Key(StopName(it->first.second)).Value(it->second);
+        }
+
+        writer.EndDict().EndDict();
+    }
+
+    for (int i = 0; i < config_.buses; ++i) {
+        writer.StartDict()
+            .Key("type"sv).Value("Bus"sv)
+            .Key("name"sv).Value(BusName(i))
+            .Key("is_roundtrip"sv).Value(i % 2 == 0)
+            .Key("stops"sv).StartArray();
+
+        for (int stop : routes_[i]) {
+            writer.Value(StopName(stop));
+        }
+
+        writer.EndArray().EndDict();
+    }
+
+    writer.EndArray();
+
+    writer.Key("render_settings"sv).StartDict()
+        .Key("width"sv).Value(1200.)
+        .Key("height"sv).Value(1200.)
+        .Key("padding"sv).Value(50.)
+        .Key("line_width"sv).Value(14.)
+        .Key("stop_radius"sv).Value(5.)
+        .Key("bus_label_font_size"sv).Value(20)
+        .Key("bus_label_offset"sv).StartArray().Value(7.).Value(15.).EndArray()
+        .Key("stop_label_font_size"sv).Value(20)
+        .Key("stop_label_offset"sv).StartArray().Value(7.).Value(-3.).EndArray()
+        .Key("underlayer_color"sv).StartArray().Value(255).Value(255).Value(255).Value(0.85).EndArray()
+        .Key("underlayer_width"sv).Value(3.)
+        .Key("color_palette"sv).StartArray()
+            .Value("green"sv)
+            .StartArray().Value(255).Value(160).Value(0).EndArray()
+            .Value("red"sv)
+        .EndArray()
+        .EndDict();
+
+    writer.Key("routing_settings"sv).StartDict()
+        .Key("bus_wait_time"sv).Value(6)
+        .Key("bus_velocity"sv).Value(40)
+        .Key("router_mode"sv).Value(config_.router_mode)
+        .Key("graph_model"sv).Value(config_.graph_model)
+        .EndDict();
+
+    WriteSerializationSettings(writer);
+
+    writer.EndDict();
+}
+
+void CityGenerator::WriteProcessRequests(ostream& out) {
+    out.precision(10);
+    json::Writer writer(out);
+
+    writer.StartDict();
+    WriteSerializationSettings(writer);
+    writer.Key("stat_requests"sv).StartArray();
+
+    vector<int> weights;
+    for (const auto& [type, weight] : config_.mix) {
+        weights.push_back(weight);
+    }
+    discrete_distribution<int> choose_type(weights.begin(), weights.end());
+
+    for (int id = 0; id < config_.requests; ++id) {
+        WriteRequest(writer, id, config_.mix.at(choose_type(generator_)).first);
+    }
+
+    writer.EndArray().EndDict();
+}
+
+const vector<geo::Coordinates>& CityGenerator::GetStops() const {
+    return stops_;
+}
+
+vector<int> CityGenerator::MakeRoute(bool circular) {
+    uniform_int_distribution<int> start(0, config_.stops - 1);
+    uniform_int_distribution<int> direction(0, 3);
+    uniform_real_distribution<double> detour(1.1, 1.4);
+
+    vector<int> route{start(generator_)};
+    // Кольцевой маршрут возвращается к началу по тем же улицам
+    const int length = circular ? (config_.route_length + 1) / 2 : config_.route_length;
+
+    while (static_cast<int>(route.size()) < length) {
+        const int current = route.back();
+        int next = current;
+
+        switch (direction(generator_)) {
+        case 0: next = current % side_ > 0 ? current - 1 : current + 1; break;
+        case 1: next = current + 1 < config_.stops && (current + 1) % side_ > 0 ? current + 1 : current - 1; break;
+        case 2: next = current >= side_ ? current - side_ : current + side_; break;
+        default: next = current + side_ < config_.stops ? current + side_ : current - side_; break;
+        }
+
+        if (next < 0 || next >= config_.stops) {
+            continue;
+        }
+        route.push_back(next);
+    }
+
+    if (circular) {
+        route.insert(route.end(), route.rbegin() + 1, route.rend());
+    }
+
+    // Дорога длиннее прямой; обратное направление берётся из прямого
+    for (size_t i = 1; i < route.size(); ++i) {
+        const int from = route[i - 1];
+        const int to = route[i];
+
+        if (!distances_.count({from, to}) && !distances_.count({to, from})) {
+            const double length_m = geo::ComputeDistance(stops_[from], stops_[to]) * detour(generator_);
+            distances_[{from, to}] = max(1, static_cast<int>(length_m));
+        }
+    }
+
+    return route;
+}
+
+void CityGenerator::WriteSerializationSettings(json::Writer& writer) const {
+    writer.Key("serialization_settings"sv).StartDict()
+        .Key("file"sv).Value(config_.file)
+        .Key("format"sv).Value(config_.format)
+        .Key("router_storage"sv).Value(config_.storage)
+        .Key("threads"sv).Value(config_.threads)
+        .EndDict();
+}
+
+void CityGenerator::WriteRequest(json::Writer& writer, int id, const string& type) {
+    uniform_int_distribution<int> stop(0, config_.stops - 1);
+    uniform_int_distribution<int> bus(0, config_.buses - 1);
+    uniform_real_distribution<double> shift(-CELL_DEGREES, CELL_DEGREES);
+
+    writer.StartDict().Key("id"sv).Value(id).Key("type"sv).Value(type);
+
+    if (type == "Bus"s) {
+        writer.Key("name"sv).Value(BusName(bus(generator_)));
+    } else if (type == "Stop"s) {
+        writer.Key("name"sv).Value(StopName(stop(generator_)));
+    } else if (type == "Route"s) {
+        writer.Key("from"sv).Value(StopName(stop(generator_)))
+            .Key("to"sv).Value(StopName(stop(generator_)));
+    } else if (type == "Nearby"s) {
+        const geo::Coordinates& center = stops_[stop(generator_)];
+        writer.Key("latitude"sv).Value(center.lat + shift(generator_))
+            .Key("longitude"sv).Value(center.lng + shift(generator_))
+            .Key("count"sv).Value(5);
+    } else if (type == "RouteMatrix"s) {
+        writer.Key("from"sv).StartArray();
+        for (int i = 0; i < 10; ++i) {
+            writer.Value(StopName(stop(generator_)));
+        }
+        writer.EndArray().Key("to"sv).StartArray();
+        for (int i = 0; i < 10; ++i) {
+            writer.Value(StopName(stop(generator_)));
+        }
+        writer.EndArray();
+    } else if (type == "Isochrone"s) {
+        writer.Key("from"sv).Value(StopName(stop(generator_)))
+            .Key("max_time"sv).Value(30);
+    } else if (type != "Map"s) {
+        throw invalid_argument("Unknown request type in mix: "s + type);
+    }
+
+    writer.EndDict();
+}
+
+} // namespace bench
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geo.h"
+#include "json.h"
+
+namespace bench {
+
+// Параметры синтетического города и входных документов для него
+struct CityConfig {
+    int stops = 1000;
+    int buses = 100;
+    int route_length = 20;
+    int requests = 2000;
+    unsigned seed = 42;
+    // Тип stat_request и его вес при случайном выборе
+    std::vector<std::pair<std::string, int>> mix = {
+        {"Bus", 2}, {"Stop", 2}, {"Route", 4}, {"Nearby", 1}, {"Map", 0},
+        {"RouteMatrix", 0}, {"Isochrone", 0}};
+    std::string router_mode = "all_pairs";
+    std::string graph_model = "stop_pairs";
+    std::string format = "protobuf";
+    std::string storage = "full";
+    int threads = 1;
+    std::string file = "bench.db";
+};
+
+std::string StopName(int index);
+std::string BusName(int index);
+
+// Город — остановки на сетке со случайным сдвигом в квадрате около 20 км.
+// Маршрут автобуса — случайное блуждание по соседним узлам сетки,
+// поэтому соседние остановки маршрута близки и на карте, и по дорогам.
+// Один и тот же seed даёт один и тот же город и те же запросы
+class CityGenerator {
+public:
+    explicit CityGenerator(const CityConfig& config);
+
+    // Документ для make_base
+    void WriteMakeBase(std::ostream& out) const;
+    // Документ для process_requests: config.requests запросов в пропорциях config.mix
+    void WriteProcessRequests(std::ostream& out);
+
+    const std::vector<geo::Coordinates>& GetStops() const;
+
+private:
+    static constexpr double BASE_LAT = 55.6;
+    static constexpr double BASE_LNG = 37.4;
+    // Около 500 метров по широте
+    static constexpr double CELL_DEGREES = 0.0045;
+
+    std::vector<int> MakeRoute(bool circular);
+    void WriteSerializationSettings(json::Writer& writer) const;
+    void WriteRequest(json::Writer& writer, int id, const std::string& type);
+
+    const CityConfig& config_;
+    std::mt19937 generator_;
+    int side_;
+    std::vector<geo::Coordinates> stops_;
+    std::vector<std::vector<int>> routes_;
+    std::map<std::pair<int, int>, int> distances_;
+};
+
+} // namespace bench
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Иерархия сжатий (Contraction Hierarchies). При построении вершины по очереди
+// «сжимаются»: если кратчайший путь u -> v -> x нельзя обойти без v, в граф
+// добавляется ребро-сокращение u -> x. Запрос — двунаправленный Дейкстра, в
+// котором обе волны поднимаются только к вершинам с большим рангом
+template <typename Weight>
+class ContractionHierarchy {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    // Сокращение заменяет пару рёбер first, second. Идентификаторы рёбер,
+    // не меньшие graph.GetEdgeCount(), ссылаются на сокращения
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId first;
+        EdgeId second;
+    };
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    // Строит иерархию по графу
+    explicit ContractionHierarchy(const Graph& graph);
+
+    // Восстанавливает ранее построенную иерархию
+    ContractionHierarchy(const Graph& graph, std::vector<size_t> ranks, std::vector<Shortcut> shortcuts);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    const std::vector<size_t>& GetRanks() const;
+    const std::vector<Shortcut>& GetShortcuts() const;
+
+private:
+    struct Arc {
+        VertexId vertex;
+        Weight weight;
+        EdgeId edge;
+    };
+    using Arcs = std::vector<Arc>;
+
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    struct RouteInternalData {
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+    using RoutesInternalData = std::vector<std::optional<RouteInternalData>>;
+
+    class Contractor;
+
+    void BuildSearchGraph();
+    void SearchStep(Queue& queue, RoutesInternalData& own, const RoutesInternalData& other,
+                    const std::vector<Arcs>& arcs, std::optional<Weight>& best, VertexId& meet) const;
+    VertexId GetEdgeFrom(EdgeId edge_id) const;
+    VertexId GetEdgeTo(EdgeId edge_id) const;
+    void UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::vector<size_t> ranks_;
+    std::vector<Shortcut> shortcuts_;
+
+    // upward_arcs_[v] — рёбра v -> x, где ранг x выше ранга v (прямая волна);
+    // downward_arcs_[v] — рёбра u -> v, где ранг u выше ранга v (обратная волна)
+    std::vector<Arcs> upward_arcs_;
+    std::vector<Arcs> downward_arcs_;
+};
+
+// Состояние, нужное только на время построения иерархии
+template <typename Weight>
+class ContractionHierarchy<Weight>::Contractor {
+public:
+    Contractor(const Graph& graph, std::vector<Shortcut>& shortcuts)
+        : graph_(graph)
+        , shortcuts_(shortcuts)
+        , out_arcs_(graph.GetVertexCount())
+        , in_arcs_(graph.GetVertexCount())
+        , contracted_neighbors_(graph.GetVertexCount(), 0)
+        , witness_data_(graph.GetVertexCount())
+    {
+        const auto& edges = graph.GetEdges();
+        for (EdgeId edge_id = 0; edge_id < edges.size(); ++edge_id) {
+            const auto& edge = edges[edge_id];
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.from != edge.to) {
+                AddArc(edge.from, edge.to, edge.weight, edge_id);
+            }
+        }
+    }
+
+    std::vector<size_t> Contract() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        std::vector<size_t> ranks(vertex_count);
+
+        using PriorityItem = std::pair<int, VertexId>;
+        std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> queue;
+
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.push({GetPriority(vertex), vertex});
+        }
+
+        size_t next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+
+            // Приоритеты пересчитываются лениво: если вершина подешевела
+            // не так сильно, как казалось, возвращаем её в очередь
+            const int priority = GetPriority(vertex);
+            if (!queue.empty() && priority > queue.top().first) {
+                queue.push({priority, vertex});
+                continue;
+            }
+
+            ContractVertex(vertex);
+            ranks[vertex] = next_rank++;
+        }
+
+        return ranks;
+    }
+
+private:
+    // Ограничение поиска свидетелей: лишнее сокращение не ломает ответы,
+    // а лишь немного замедляет запросы
+    static constexpr size_t MAX_WITNESS_SETTLED = 500;
+
+    void AddArc(VertexId from, VertexId to, const Weight& weight, EdgeId edge_id) {
+        auto& out_arcs = out_arcs_[from];
+        auto it = std::find_if(out_arcs.begin(), out_arcs.end(),
+                               [to](const Arc& arc) { return arc.vertex == to; });
+
+        if (it == out_arcs.end()) {
+            out_arcs.push_back({to, weight, edge_id});
+            in_arcs_[to].push_back({from, weight, edge_id});
+            return;
+        }
+
+        if (weight < it->weight) {
+            *it = {to, weight, edge_id};
+
+            auto& in_arcs = in_arcs_[to];
+            *std::find_if(in_arcs.begin(), in_arcs.end(),
+                          [from](const Arc& arc) { return arc.vertex == from; }) = {from, weight, edge_id};
+        }
+    }
+
+    static void RemoveArcsTo(Arcs& arcs, VertexId vertex) {
+        arcs.erase(std::remove_if(arcs.begin(), arcs.end(),
+                                  [vertex](const Arc& arc) { return arc.vertex == vertex; }),
+                   arcs.end());
+    }
+
+    // Дейкстра из source в оставшемся графе без вершины excluded, не дальше limit
+    void RunWitnessSearch(VertexId source, VertexId excluded, const Weight& limit) {
+        for (const VertexId vertex : witness_touched_) {
+            witness_data_[vertex].reset();
+        }
+        witness_touched_.clear();
+
+        Queue queue;
+        witness_data_[source] = ZERO_WEIGHT;
+        witness_touched_.push_back(source);
+        queue.push({ZERO_WEIGHT, source});
+
+        size_t settled = 0;
+        while (!queue.empty() && settled < MAX_WITNESS_SETTLED) {
+            const QueueItem item = queue.top();
+            queue.pop();
+
+            if (*witness_data_[item.vertex] < item.weight) {
+                continue;
+            }
+            if (limit < item.weight) {
+                break;
+            }
+            ++settled;
+
+            for (const Arc& arc : out_arcs_[item.vertex]) {
+                if (arc.vertex == excluded) {
+                    continue;
+                }
+
+                const Weight candidate_weight = item.weight + arc.weight;
+                auto& witness = witness_data_[arc.vertex];
+
+                if (!witness || candidate_weight < *witness) {
+                    if (!witness) {
+                        witness_touched_.push_back(arc.vertex);
+                    }
+                    witness = candidate_weight;
+                    queue.push({candidate_weight, arc.vertex});
+                }
+            }
+        }
+    }
+
+    std::vector<Shortcut> FindShortcuts(VertexId vertex) {
+        std::vector<Shortcut> result;
+        const Arcs& out_arcs = out_arcs_[vertex];
+
+        if (out_arcs.empty()) {
+            return result;
+        }
+
+        for (const Arc& in_arc : in_arcs_[vertex]) {
+            Weight limit = ZERO_WEIGHT;
+            for (const Arc& out_arc : out_arcs) {
+                const Weight candidate_weight = in_arc.weight + out_arc.weight;
+                if (limit < candidate_weight) {
+                    limit = candidate_weight;
+                }
+            }
+
+            RunWitnessSearch(in_arc.vertex, vertex, limit);
+
+            for (const Arc& out_arc : out_arcs) {
+                if (out_arc.vertex == in_arc.vertex) {
+                    continue;
+                }
+
+                const Weight candidate_weight = in_arc.weight + out_arc.weight;
+                const auto& witness = witness_data_[out_arc.vertex];
+
+                if (!witness || candidate_weight < *witness) {
+                    result.push_back({in_arc.vertex, out_arc.vertex, candidate_weight, in_arc.edge, out_arc.edge});
+                }
+            }
+        }
+
+        return result;
+    }
+
+    // Разность рёбер: сколько сокращений добавится минус сколько рёбер исчезнет
+    int GetPriority(VertexId vertex) {
+        const int shortcuts_count = static_cast<int>(FindShortcuts(vertex).size());
+        const int removed_count = static_cast<int>(in_arcs_[vertex].size() + out_arcs_[vertex].size());
+
+        return shortcuts_count - removed_count + contracted_neighbors_[vertex];
+    }
+
+    void ContractVertex(VertexId vertex) {
+        for (Shortcut& shortcut : FindShortcuts(vertex)) {
+            const EdgeId edge_id = graph_.GetEdgeCount() + shortcuts_.size();
+            AddArc(shortcut.from, shortcut.to, shortcut.weight, edge_id);
+            shortcuts_.push_back(std::move(shortcut));
+        }
+
+        for (const Arc& arc : in_arcs_[vertex]) {
+            RemoveArcsTo(out_arcs_[arc.vertex], vertex);
+            ++contracted_neighbors_[arc.vertex];
+        }
+        for (const Arc& arc : out_arcs_[vertex]) {
+            RemoveArcsTo(in_arcs_[arc.vertex], vertex);
+            ++contracted_neighbors_[arc.vertex];
+        }
+
+        in_arcs_[vertex].clear();
+        out_arcs_[vertex].clear();
+    }
+
+    const Graph& graph_;
+    std::vector<Shortcut>& shortcuts_;
+    std::vector<Arcs> out_arcs_;
+    std::vector<Arcs> in_arcs_;
+    std::vector<int> contracted_neighbors_;
+
+    std::vector<std::optional<Weight>> witness_data_;
+    std::vector<VertexId> witness_touched_;
+};
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph)
+    : graph_(graph)
+{
+    Contractor contractor(graph, shortcuts_);
+    ranks_ = contractor.Contract();
+
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+ContractionHierarchy<Weight>::ContractionHierarchy(const Graph& graph, std::vector<size_t> ranks,
+                                                   std::vector<Shortcut> shortcuts)
+    : graph_(graph)
+    , ranks_(std::move(ranks))
+    , shortcuts_(std::move(shortcuts))
+{
+    if (ranks_.size() != graph.GetVertexCount()) {
+        throw std::invalid_argument("Ranks don't match the graph");
+    }
+
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::BuildSearchGraph() {
+    upward_arcs_.assign(graph_.GetVertexCount(), {});
+    downward_arcs_.assign(graph_.GetVertexCount(), {});
+
+    auto add_edge = [this](VertexId from, VertexId to, const Weight& weight, EdgeId edge_id) {
+        if (from == to) {
+            return;
+        }
+        if (ranks_[from] < ranks_[to]) {
+            upward_arcs_[from].push_back({to, weight, edge_id});
+        } else {
+            downward_arcs_[to].push_back({from, weight, edge_id});
+        }
+    };
+
+    const auto& edges = graph_.GetEdges();
+    for (EdgeId edge_id = 0; edge_id < edges.size(); ++edge_id) {
+        add_edge(edges[edge_id].from, edges[edge_id].to, edges[edge_id].weight, edge_id);
+    }
+    for (size_t i = 0; i < shortcuts_.size(); ++i) {
+        add_edge(shortcuts_[i].from, shortcuts_[i].to, shortcuts_[i].weight, edges.size() + i);
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::SearchStep(Queue& queue, RoutesInternalData& own,
+                                              const RoutesInternalData& other,
+                                              const std::vector<Arcs>& arcs,
+                                              std::optional<Weight>& best, VertexId& meet) const {
+    const QueueItem item = queue.top();
+    queue.pop();
+
+    if (own[item.vertex]->weight < item.weight) {
+        return;
+    }
+
+    if (other[item.vertex]) {
+        const Weight candidate_weight = item.weight + other[item.vertex]->weight;
+        if (!best || candidate_weight < *best) {
+            best = candidate_weight;
+            meet = item.vertex;
+        }
+    }
+
+    for (const Arc& arc : arcs[item.vertex]) {
+        const Weight candidate_weight = item.weight + arc.weight;
+        auto& route_internal_data = own[arc.vertex];
+
+        if (!route_internal_data || candidate_weight < route_internal_data->weight) {
+            route_internal_data = RouteInternalData{candidate_weight, arc.edge};
+            queue.push({candidate_weight, arc.vertex});
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    RoutesInternalData forward(vertex_count);
+    RoutesInternalData backward(vertex_count);
+    Queue forward_queue;
+    Queue backward_queue;
+
+    forward.at(from) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    backward.at(to) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    forward_queue.push({ZERO_WEIGHT, from});
+    backward_queue.push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best;
+    VertexId meet = from;
+
+    while (true) {
+        // Волна останавливается, когда все её вершины не ближе уже найденного пути
+        const bool forward_active = !forward_queue.empty()
+            && (!best || forward_queue.top().weight < *best);
+        const bool backward_active = !backward_queue.empty()
+            && (!best || backward_queue.top().weight < *best);
+
+        if (!forward_active && !backward_active) {
+            break;
+        }
+
+        if (forward_active
+            && (!backward_active || !(backward_queue.top().weight < forward_queue.top().weight))) {
+            SearchStep(forward_queue, forward, backward, upward_arcs_, best, meet);
+        } else {
+            SearchStep(backward_queue, backward, forward, downward_arcs_, best, meet);
+        }
+    }
+
+    if (!best) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> packed_edges;
+    for (std::optional<EdgeId> edge_id = forward[meet]->prev_edge;
+         edge_id;
+         edge_id = forward[GetEdgeFrom(*edge_id)]->prev_edge)
+    {
+        packed_edges.push_back(*edge_id);
+    }
+    std::reverse(packed_edges.begin(), packed_edges.end());
+
+    for (std::optional<EdgeId> edge_id = backward[meet]->prev_edge;
+         edge_id;
+         edge_id = backward[GetEdgeTo(*edge_id)]->prev_edge)
+    {
+        packed_edges.push_back(*edge_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const EdgeId edge_id : packed_edges) {
+        UnpackEdge(edge_id, edges);
+    }
+
+    return RouteInfo{forward[meet]->weight + backward[meet]->weight, std::move(edges)};
+}
+
+template <typename Weight>
+VertexId ContractionHierarchy<Weight>::GetEdgeFrom(EdgeId edge_id) const {
+    const size_t edge_count = graph_.GetEdgeCount();
+    return edge_id < edge_count ? graph_.GetEdge(edge_id).from : shortcuts_[edge_id - edge_count].from;
+}
+
+template <typename Weight>
+VertexId ContractionHierarchy<Weight>::GetEdgeTo(EdgeId edge_id) const {
+    const size_t edge_count = graph_.GetEdgeCount();
+    return edge_id < edge_count ? graph_.GetEdge(edge_id).to : shortcuts_[edge_id - edge_count].to;
+}
+
+template <typename Weight>
+void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId>& edges) const {
+    const size_t edge_count = graph_.GetEdgeCount();
+    std::vector<EdgeId> stack{edge_id};
+
+    while (!stack.empty()) {
+        const EdgeId id = stack.back();
+        stack.pop_back();
+
+        if (id < edge_count) {
+            edges.push_back(id);
+            continue;
+        }
+
+        const Shortcut& shortcut = shortcuts_[id - edge_count];
+        stack.push_back(shortcut.second);
+        stack.push_back(shortcut.first);
+    }
+}
+
+template <typename Weight>
+const std::vector<size_t>& ContractionHierarchy<Weight>::GetRanks() const {
+    return ranks_;
+}
+
+template <typename Weight>
+const std::vector<typename ContractionHierarchy<Weight>::Shortcut>&
+ContractionHierarchy<Weight>::GetShortcuts() const {
+    return shortcuts_;
+}
+
+}  // namespace graph
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Начало или конец поиска сразу от нескольких вершин: weight — сколько уже
+// набрано до вершины-источника или сколько ещё добавится после вершины-цели
+template <typename Weight>
+struct Terminal {
+    VertexId vertex;
+    Weight weight;
+};
+
+// Маршрутизатор, который ничего не предвычисляет: на каждый запрос запускается
+// алгоритм Дейкстры с двоичной кучей от вершины from до вершины to.
+// Память — O(V + E) вместо матрицы V×V у Router.
+// Graph — любой граф с интерфейсом чтения DirectedWeightedGraph
+template <typename Weight, typename Graph = DirectedWeightedGraph<Weight>>
+class DijkstraRouter {
+public:
+    explicit DijkstraRouter(const Graph& graph);
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Пути от from сразу до всех targets за один поиск, который останавливается,
+    // как только достигнута последняя цель; nullopt — цель недостижима.
+    // Без with_edges заполняются только веса
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from, const std::vector<VertexId>& targets,
+        bool with_edges = true) const;
+
+    // Все вершины, путь до которых от from не тяжелее max_weight, с весами путей
+    // по возрастанию веса. Веса хранятся только для достигнутых вершин, поэтому
+    // время и память зависят от размера найденной области, а не всего графа
+    std::vector<std::pair<VertexId, Weight>> FindReachable(VertexId from, const Weight& max_weight) const;
+
+    struct MultiRouteInfo {
+        VertexId from;
+        VertexId to;
+        // С учётом весов источника и цели
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    // Лучший путь от любого из sources до любой из targets за один проход
+    std::optional<MultiRouteInfo> BuildRoute(const std::vector<Terminal<Weight>>& sources,
+        const std::vector<Terminal<Weight>>& targets) const;
+
+    struct RouteInternalData {
+        Weight weight;
+        std::optional<EdgeId> prev_edge;
+    };
+
+private:
+    struct QueueItem {
+        Weight weight;
+        VertexId vertex;
+
+        bool operator>(const QueueItem& other) const {
+            return weight > other.weight;
+        }
+    };
+
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+    using RoutesInternalData = std::vector<std::optional<RouteInternalData>>;
+
+    // Рёбра пути до to по цепочке prev_edge, от начала пути
+    std::vector<EdgeId> ExpandRoute(const RoutesInternalData& routes_internal_data, VertexId to) const;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+};
+
+template <typename Weight, typename Graph>
+DijkstraRouter<Weight, Graph>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight, typename Graph>
+std::optional<typename DijkstraRouter<Weight, Graph>::RouteInfo>
+DijkstraRouter<Weight, Graph>::BuildRoute(VertexId from, VertexId to) const {
+    std::vector<std::optional<RouteInternalData>> routes_internal_data(graph_.GetVertexCount());
+    Queue queue;
+
+    routes_internal_data.at(from) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    queue.push({ZERO_WEIGHT, from});
+
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+
+        // В куче могут остаться устаревшие записи, для которых уже найден путь короче
+        if (routes_internal_data[item.vertex]->weight < item.weight) {
+            continue;
+        }
+
+        if (item.vertex == to) {
+            break;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+            auto& route_internal_data = routes_internal_data[edge.to];
+
+            if (!route_internal_data || candidate_weight < route_internal_data->weight) {
+                route_internal_data = RouteInternalData{candidate_weight, edge_id};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+
+    const auto& route_internal_data = routes_internal_data.at(to);
+    if (!route_internal_data) {
+        return std::nullopt;
+    }
+
+    return RouteInfo{route_internal_data->weight, ExpandRoute(routes_internal_data, to)};
+}
+
+template <typename Weight, typename Graph>
+std::vector<std::optional<typename DijkstraRouter<Weight, Graph>::RouteInfo>>
+DijkstraRouter<Weight, Graph>::BuildRoutes(VertexId from, const std::vector<VertexId>& targets,
+    bool with_edges) const {
+
+    RoutesInternalData routes_internal_data(graph_.GetVertexCount());
+    std::vector<bool> is_target(graph_.GetVertexCount(), false);
+    size_t targets_left = 0;
+
+    for (const VertexId target : targets) {
+        if (!is_target.at(target)) {
+            is_target[target] = true;
+            ++targets_left;
+        }
+    }
+
+    Queue queue;
+    routes_internal_data.at(from) = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+    queue.push({ZERO_WEIGHT, from});
+
+    while (!queue.empty() && targets_left > 0) {
+        const QueueItem item = queue.top();
+        queue.pop();
+
+        if (routes_internal_data[item.vertex]->weight < item.weight) {
+            continue;
+        }
+
+        if (is_target[item.vertex]) {
+            is_target[item.vertex] = false;
+            --targets_left;
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+            auto& route_internal_data = routes_internal_data[edge.to];
+
+            if (!route_internal_data || candidate_weight < route_internal_data->weight) {
+                route_internal_data = RouteInternalData{candidate_weight, edge_id};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+
+    std::vector<std::optional<RouteInfo>> result;
+    result.reserve(targets.size());
+
+    for (const VertexId target : targets) {
+        const auto& route_internal_data = routes_internal_data[target];
+
+        if (!route_internal_data) {
+            result.emplace_back(std::nullopt);
+            continue;
+        }
+
+        result.push_back(RouteInfo{route_internal_data->weight,
+            with_edges ? ExpandRoute(routes_internal_data, target) : std::vector<EdgeId>{}});
+    }
+
+    return result;
+}
+
+template <typename Weight, typename Graph>
+std::vector<std::pair<VertexId, Weight>>
+DijkstraRouter<Weight, Graph>::FindReachable(VertexId from, const Weight& max_weight) const {
+    if (from >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex is out of graph");
+    }
+
+    std::vector<std::pair<VertexId, Weight>> result;
+    std::unordered_map<VertexId, Weight> weights;
+    Queue queue;
+
+    weights.emplace(from, ZERO_WEIGHT);
+    queue.push({ZERO_WEIGHT, from});
+
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+
+        if (weights.at(item.vertex) < item.weight) {
+            continue;
+        }
+
+        result.emplace_back(item.vertex, item.weight);
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+
+            // Вершины за пределами бюджета не попадают ни в кучу, ни в weights
+            if (max_weight < candidate_weight) {
+                continue;
+            }
+
+            const auto [it, inserted] = weights.emplace(edge.to, candidate_weight);
+
+            if (inserted || candidate_weight < it->second) {
+                it->second = candidate_weight;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+
+    return result;
+}
+
+template <typename Weight, typename Graph>
+std::optional<typename DijkstraRouter<Weight, Graph>::MultiRouteInfo>
+DijkstraRouter<Weight, Graph>::BuildRoute(const std::vector<Terminal<Weight>>& sources,
+    const std::vector<Terminal<Weight>>& targets) const {
+
+    RoutesInternalData routes_internal_data(graph_.GetVertexCount());
+    std::vector<std::optional<Weight>> target_weights(graph_.GetVertexCount());
+    Queue queue;
+
+    for (const auto& [vertex, weight] : sources) {
+        auto& route_internal_data = routes_internal_data.at(vertex);
+
+        if (!route_internal_data || weight < route_internal_data->weight) {
+            route_internal_data = RouteInternalData{weight, std::nullopt};
+            queue.push({weight, vertex});
+        }
+    }
+
+    for (const auto& [vertex, weight] : targets) {
+        auto& target_weight = target_weights.at(vertex);
+
+        if (!target_weight || weight < *target_weight) {
+            target_weight = weight;
+        }
+    }
+
+    std::optional<MultiRouteInfo> best;
+
+    while (!queue.empty()) {
+        const QueueItem item = queue.top();
+        queue.pop();
+
+        if (routes_internal_data[item.vertex]->weight < item.weight) {
+            continue;
+        }
+
+        // Веса целей неотрицательны, так что дальше ничего лучше найденного не будет
+        if (best && !(item.weight < best->weight)) {
+            break;
+        }
+
+        if (target_weights[item.vertex]) {
+            const Weight total_weight = item.weight + *target_weights[item.vertex];
+
+            if (!best || total_weight < best->weight) {
+                best = MultiRouteInfo{0, item.vertex, total_weight, {}};
+            }
+        }
+
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(item.vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = item.weight + edge.weight;
+            auto& route_internal_data = routes_internal_data[edge.to];
+
+            if (!route_internal_data || candidate_weight < route_internal_data->weight) {
+                route_internal_data = RouteInternalData{candidate_weight, edge_id};
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+
+    if (!best) {
+        return std::nullopt;
+    }
+
+    best->edges = ExpandRoute(routes_internal_data, best->to);
+    best->from = best->edges.empty() ? best->to : graph_.GetEdge(best->edges.front()).from;
+
+    return best;
+}
+
+template <typename Weight, typename Graph>
+std::vector<EdgeId> DijkstraRouter<Weight, Graph>::ExpandRoute(
+    const RoutesInternalData& routes_internal_data, VertexId to) const {
+
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = routes_internal_data.at(to)->prev_edge;
+         edge_id;
+         edge_id = routes_internal_data[graph_.GetEdge(*edge_id).from]->prev_edge)
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return edges;
+}
+
+}  // namespace graph
@@ -12,6 +12,7 @@
  *
  */
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <set>
@@ -21,6 +22,11 @@
 
 namespace transport {
 
+// Плотные номера остановок и автобусов: индексы в хранилищах справочника
+// в порядке добавления
+using StopId = uint32_t;
+using BusId = uint32_t;
+
 struct BusStat {
     int all_stops;
     int unique_stops;
@@ -32,13 +38,14 @@ struct Stop {
     std::string name;
     geo::Coordinates coordinates;
     std::set<std::string_view> buses_through;
-    int id;
+    StopId id;
 };
 
 struct Bus {
     std::string name;
     std::vector<Stop*> bus_stops;
     bool circular;
+    BusId id;
 };
 
 namespace parsed {
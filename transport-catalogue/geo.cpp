@@ -3,19 +3,138 @@
 
 #include <cmath>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define GEO_HAS_AVX2_KERNEL
+#endif
+
 namespace geo {
 
+namespace {
+
+const double dr = M_PI / 180.;
+const double earth_radius = 6371000;
+
+// dots[i] — косинус центрального угла между вершинами i и i + 1, до вызова
+// в нём cos разности их долгот. Порядок умножений тот же, что в ComputeDistance;
+// у совпадающих вершин 1, чтобы acos дал ровно 0
+void ComputeDotsScalar(const PathPoints& points, std::vector<double>& dots, size_t first = 0) {
+    for (size_t i = first; i < dots.size(); ++i) {
+        if (points.lat[i] == points.lat[i + 1] && points.lng[i] == points.lng[i + 1]) {
+            dots[i] = 1;
+            continue;
+        }
+
+        dots[i] = points.sin_lat[i] * points.sin_lat[i + 1]
+            + points.cos_lat[i] * points.cos_lat[i + 1] * dots[i];
+    }
+}
+
+#ifdef GEO_HAS_AVX2_KERNEL
+
+// FMA не используется намеренно: округление должно совпадать со скалярным
+__attribute__((target("avx2")))
+void ComputeDotsAvx2(const PathPoints& points, std::vector<double>& dots) {
+    const size_t count = dots.size();
+    const __m256d one = _mm256_set1_pd(1.);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const __m256d sin_from = _mm256_loadu_pd(&points.sin_lat[i]);
+        const __m256d sin_to = _mm256_loadu_pd(&points.sin_lat[i + 1]);
+        const __m256d cos_from = _mm256_loadu_pd(&points.cos_lat[i]);
+        const __m256d cos_to = _mm256_loadu_pd(&points.cos_lat[i + 1]);
+        const __m256d cos_lng = _mm256_loadu_pd(&dots[i]);
+
+        const __m256d dot = _mm256_add_pd(_mm256_mul_pd(sin_from, sin_to),
+            _mm256_mul_pd(_mm256_mul_pd(cos_from, cos_to), cos_lng));
+
+        const __m256d same = _mm256_and_pd(
+            _mm256_cmp_pd(_mm256_loadu_pd(&points.lat[i]), _mm256_loadu_pd(&points.lat[i + 1]), _CMP_EQ_OQ),
+            _mm256_cmp_pd(_mm256_loadu_pd(&points.lng[i]), _mm256_loadu_pd(&points.lng[i + 1]), _CMP_EQ_OQ));
+
+        _mm256_storeu_pd(&dots[i], _mm256_blendv_pd(dot, one, same));
+    }
+
+    // Без сброса верхних половин регистров каждый следующий скалярный acos
+    // платит за переход между AVX и SSE, и перегон считается в разы дольше
+    _mm256_zeroupper();
+    ComputeDotsScalar(points, dots, i);
+}
+
+bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#endif
+
+} // namespace
+
 double ComputeDistance(Coordinates from, Coordinates to) {
     using namespace std;
     if (from == to) {
         return 0;
     }
-    static const double dr = M_PI / 180.;
-    static const double earth_radius = 6371000;
     
     return acos(sin(from.lat * dr) * sin(to.lat * dr)
                 + cos(from.lat * dr) * cos(to.lat * dr) * cos(abs(from.lng - to.lng) * dr))
         * earth_radius;
 }
 
-}  // namespace geo
\ No newline at end of file
+LatitudeTrig ComputeLatitudeTrig(double lat) {
+    return {std::sin(lat * dr), std::cos(lat * dr)};
+}
+
+void PathPoints::Reserve(size_t count) {
+    lat.reserve(count);
+    lng.reserve(count);
+    sin_lat.reserve(count);
+    cos_lat.reserve(count);
+}
+
+void PathPoints::Add(Coordinates coordinates, LatitudeTrig trig) {
+    lat.push_back(coordinates.lat);
+    lng.push_back(coordinates.lng);
+    sin_lat.push_back(trig.sin_lat);
+    cos_lat.push_back(trig.cos_lat);
+}
+
+size_t PathPoints::Size() const {
+    return lat.size();
+}
+
+double ComputePathLength(const PathPoints& points) {
+    using namespace std;
+
+    if (points.Size() < 2) {
+        return 0;
+    }
+
+    vector<double> dots(points.Size() - 1);
+
+    for (size_t i = 0; i < dots.size(); ++i) {
+        dots[i] = cos(abs(points.lng[i] - points.lng[i + 1]) * dr);
+    }
+
+#ifdef GEO_HAS_AVX2_KERNEL
+    if (HasAvx2()) {
+        ComputeDotsAvx2(points, dots);
+    } else {
+        ComputeDotsScalar(points, dots);
+    }
+#else
+    ComputeDotsScalar(points, dots);
+#endif
+
+    // Суммируем в том же порядке, что и цикл по ComputeDistance
+    double length = 0;
+
+    for (double dot : dots) {
+        length += acos(dot) * earth_radius;
+    }
+
+    return length;
+}
+
+}  // namespace geo
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 namespace geo {
 
 struct Coordinates {
@@ -15,4 +18,31 @@ struct Coordinates {
 
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// Синус и косинус широты, посчитанные один раз на точку
+struct LatitudeTrig {
+    double sin_lat;
+    double cos_lat;
+};
+
+LatitudeTrig ComputeLatitudeTrig(double lat);
+
+// Вершины ломаной по столбцам, чтобы соседние точки читались одной векторной загрузкой
+struct PathPoints {
+    std::vector<double> lat;
+    std::vector<double> lng;
+    std::vector<double> sin_lat;
+    std::vector<double> cos_lat;
+
+    void Reserve(size_t count);
+    void Add(Coordinates coordinates, LatitudeTrig trig);
+    size_t Size() const;
+};
+
+// Сумма ComputeDistance по соседним вершинам, совпадающая с ней побитово:
+// на перегон остаются только cos разности долгот и acos, а скалярные
+// произведения собираются по четыре с AVX2, если процессор его поддерживает.
+// Приближённые векторные cos и acos не годятся: около 1 acos усиливает
+// ошибку в последнем бите до 1e-5 от длины коротких перегонов
+double ComputePathLength(const PathPoints& points);
+
 }  // namespace geo
\ No newline at end of file
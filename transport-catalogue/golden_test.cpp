@@ -0,0 +1,488 @@
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "city_generator.h"
+#include "geo.h"
+#include "json.h"
+#include "json_builder.h"
+#include "json_reader.h"
+#include "request_handler.h"
+#include "transport_catalogue.h"
+
+// Проверки эквивалентности на синтетическом городе из city_generator.h.
+// Ответы на один и тот же набор stat_requests при разных форматах базы,
+// режимах маршрутизатора и способах хранения сравниваются с эталоном —
+// protobuf и DIJKSTRA с той же моделью графа. Совпасть должно всё, кроме
+// состава маршрутов Route между остановками: при равных по времени путях
+// разные маршрутизаторы вправе выбрать разные, поэтому у них сверяется время.
+// Usage: golden_test geo|requests|mapped|transfer|latency
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+void Check(bool condition, const string& message) {
+    if (!condition) {
+        throw runtime_error(message);
+    }
+}
+
+string ToString(const json::Node& node) {
+    ostringstream out;
+    out.precision(17);
+    json::Print(json::Document{node}, out);
+    return out.str();
+}
+
+bool IsNear(double lhs, double rhs) {
+    return abs(lhs - rhs) <= 1e-9 * max(1., max(abs(lhs), abs(rhs)));
+}
+
+// Параметры базы: всё, чем варианты отличаются друг от друга
+struct Variant {
+    string format = "protobuf"s;
+    string router = "dijkstra"s;
+    string graph = "stop_pairs"s;
+    string storage = "full"s;
+    int threads = 1;
+
+    string GetName() const {
+        return format + '/' + router + '/' + graph + '/' + storage + "/threads "s + to_string(threads);
+    }
+};
+
+bench::CityConfig MakeCityConfig(const Variant& variant) {
+    bench::CityConfig config;
+    config.stops = 200;
+    config.buses = 80;
+    config.route_length = 24;
+    // В модели с пересадками вершин в десятки раз больше, чем остановок,
+    // и на полном городе матрица ALL_PAIRS строилась бы полминуты
+    if (variant.graph == "transfer"s) {
+        config.stops = 120;
+        config.buses = 40;
+        config.route_length = 16;
+    }
+    config.seed = 7;
+    config.router_mode = variant.router;
+    config.graph_model = variant.graph;
+    config.format = variant.format;
+    config.storage = variant.storage;
+    config.threads = variant.threads;
+    config.file = (filesystem::temp_directory_path() / "golden_test.db"s).string();
+    return config;
+}
+
+// Запросы всех типов, включая ненайденные названия и маршруты между точками
+json::Array MakeRequests(const bench::CityConfig& config, const vector<geo::Coordinates>& stops) {
+    mt19937 generator(config.seed);
+    uniform_int_distribution<int> stop(0, config.stops - 1);
+    // Около полукилометра: точка рядом с остановкой, но не на ней
+    uniform_real_distribution<double> shift(-0.005, 0.005);
+
+    auto near_stop = [&] {
+        const geo::Coordinates& center = stops[stop(generator)];
+        return geo::Coordinates{center.lat + shift(generator), center.lng + shift(generator)};
+    };
+    auto random_stop = [&] {
+        return bench::StopName(stop(generator));
+    };
+
+    json::Builder builder;
+    int id = 0;
+
+    builder.StartArray();
+
+    auto start_request = [&builder, &id](string type) {
+        builder.StartDict();
+        builder.Key("id"s).Value(id++);
+        builder.Key("type"s).Value(move(type));
+    };
+    auto add_point = [&builder](string key, geo::Coordinates coordinates) {
+        builder.Key(move(key)).StartDict()
+            .Key("latitude"s).Value(coordinates.lat)
+            .Key("longitude"s).Value(coordinates.lng)
+            .EndDict();
+    };
+    auto add_stop_names = [&builder, &random_stop](string key, int count) {
+        builder.Key(move(key)).StartArray();
+        for (int i = 0; i < count; ++i) {
+            builder.Value(random_stop());
+        }
+        builder.EndArray();
+    };
+
+    for (int i = 0; i < config.buses; ++i) {
+        start_request("Bus"s);
+        builder.Key("name"s).Value(bench::BusName(i)).EndDict();
+    }
+    start_request("Bus"s);
+    builder.Key("name"s).Value("No such bus"s).EndDict();
+
+    for (int i = 0; i < 20; ++i) {
+        start_request("Stop"s);
+        builder.Key("name"s).Value(random_stop()).EndDict();
+    }
+    start_request("Stop"s);
+    builder.Key("name"s).Value("No such stop"s).EndDict();
+
+    for (int i = 0; i < 60; ++i) {
+        start_request("Route"s);
+        builder.Key("from"s).Value(random_stop());
+        builder.Key("to"s).Value(random_stop()).EndDict();
+    }
+    start_request("Route"s);
+    builder.Key("from"s).Value(bench::StopName(0)).Key("to"s).Value(bench::StopName(0)).EndDict();
+
+    // Маршруты с пешими участками: точка — точка, точка — остановка и обратно
+    for (int i = 0; i < 30; ++i) {
+        start_request("Route"s);
+        add_point("from"s, near_stop());
+        add_point("to"s, near_stop());
+        builder.EndDict();
+    }
+    for (int i = 0; i < 10; ++i) {
+        start_request("Route"s);
+        add_point("from"s, near_stop());
+        builder.Key("to"s).Value(random_stop()).EndDict();
+
+        start_request("Route"s);
+        builder.Key("from"s).Value(random_stop());
+        add_point("to"s, near_stop());
+        builder.EndDict();
+    }
+    // Соседние точки, между которыми быстрее дойти пешком
+    for (int i = 0; i < 5; ++i) {
+        const geo::Coordinates from = near_stop();
+        start_request("Route"s);
+        add_point("from"s, from);
+        add_point("to"s, {from.lat + 0.001, from.lng + 0.001});
+        builder.EndDict();
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        start_request("RouteMatrix"s);
+        add_stop_names("from"s, 8);
+        add_stop_names("to"s, 8);
+        builder.EndDict();
+    }
+    start_request("RouteMatrix"s);
+    add_stop_names("from"s, 4);
+    add_stop_names("to"s, 4);
+    builder.Key("paths"s).Value(true).EndDict();
+
+    for (int i = 0; i < 5; ++i) {
+        start_request("Isochrone"s);
+        builder.Key("from"s).Value(random_stop());
+        builder.Key("max_time"s).Value(15 + 5 * i).EndDict();
+    }
+    start_request("Isochrone"s);
+    builder.Key("from"s).Value(random_stop());
+    builder.Key("max_time"s).Value(20).Key("render"s).Value(true).EndDict();
+
+    for (int i = 0; i < 10; ++i) {
+        const geo::Coordinates point = near_stop();
+        start_request("Nearby"s);
+        builder.Key("latitude"s).Value(point.lat).Key("longitude"s).Value(point.lng)
+            .Key("count"s).Value(5).EndDict();
+    }
+
+    start_request("Map"s);
+    builder.EndDict();
+
+    return builder.EndArray().Build().AsArray();
+}
+
+// Строит базу, как make_base, загружает её, как process_requests, и отвечает на requests
+json::Node Process(const Variant& variant, const json::Array& requests,
+    const function<void(transport::RequestHandler&)>& prepare = {}) {
+
+    using namespace transport;
+
+    const bench::CityConfig config = MakeCityConfig(variant);
+    const bench::CityGenerator city(config);
+
+    ostringstream make_text;
+    city.WriteMakeBase(make_text);
+    istringstream make_input(make_text.str());
+
+    TransportCatalogue catalogue;
+    const JsonReader reader(make_input, catalogue);
+    const serialize::Settings settings = reader.GetSerializeSettings();
+
+    RequestHandler(catalogue).Serialize(settings, reader.GetRenderSettings(), reader.GetRouteSettingsOpt());
+
+    TransportCatalogue loaded_catalogue;
+    RequestHandler handler(loaded_catalogue);
+
+    if (prepare) {
+        prepare(handler);
+    }
+
+    handler.Deserialize(settings);
+
+    // Точности по умолчанию не хватает, чтобы заметить расхождение в последних знаках
+    ostringstream output;
+    output.precision(17);
+    handler.PrintJsonResponse(requests, output);
+
+    filesystem::remove(config.file);
+
+    istringstream response_input(output.str());
+    return json::Load(response_input).GetRoot();
+}
+
+json::Array GetRequestsForCheck(const Variant& variant) {
+    const bench::CityConfig config = MakeCityConfig(variant);
+    return MakeRequests(config, bench::CityGenerator(config).GetStops());
+}
+
+double SumItemsTime(const json::Array& items) {
+    double total = 0;
+    for (const auto& item : items) {
+        total += item.AsDict().at("time"s).AsDouble();
+    }
+    return total;
+}
+
+void CompareRoute(const json::Dict& expected, const json::Dict& actual, const string& context) {
+    if (expected.count("error_message"s) > 0) {
+        Check(json::Node{expected} == json::Node{actual}, context + ": expected not found");
+        return;
+    }
+
+    Check(actual.count("total_time"s) > 0, context + ": route not found");
+
+    const double total_time = actual.at("total_time"s).AsDouble();
+    Check(IsNear(expected.at("total_time"s).AsDouble(), total_time), context + ": total_time differs");
+    Check(IsNear(SumItemsTime(actual.at("items"s).AsArray()), total_time),
+        context + ": items don't add up to total_time");
+}
+
+// Ответы варианта совпадают с эталонными; у Route между остановками — время
+void CompareResponses(const json::Array& requests, const json::Node& expected, const json::Node& actual,
+    const string& variant_name) {
+
+    const json::Array& expected_responses = expected.AsArray();
+    const json::Array& actual_responses = actual.AsArray();
+
+    Check(expected_responses.size() == actual_responses.size(), variant_name + ": wrong number of responses");
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const json::Dict& request = requests[i].AsDict();
+        const json::Node& expected_response = expected_responses[i];
+        const json::Node& actual_response = actual_responses[i];
+
+        const string context = variant_name + ", request "s + to_string(i) + ' ' + request.at("type"s).AsString();
+        const bool is_stops_route = request.at("type"s).AsString() == "Route"s
+            && request.at("from"s).IsString() && request.at("to"s).IsString();
+
+        if (is_stops_route) {
+            CompareRoute(expected_response.AsDict(), actual_response.AsDict(), context);
+        } else if (expected_response != actual_response) {
+            throw runtime_error(context + ":\nexpected "s + ToString(expected_response)
+                + "\nactual "s + ToString(actual_response));
+        }
+    }
+}
+
+void CheckVariants(const Variant& reference, const vector<Variant>& variants) {
+    const json::Array requests = GetRequestsForCheck(reference);
+    const json::Node expected = Process(reference, requests);
+
+    // Эталон сам себе не противоречит: у найденных маршрутов время сходится
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const json::Dict& response = expected.AsArray()[i].AsDict();
+
+        if (response.count("items"s) > 0) {
+            Check(IsNear(SumItemsTime(response.at("items"s).AsArray()), response.at("total_time"s).AsDouble()),
+                reference.GetName() + ", request "s + to_string(i) + ": items don't add up to total_time");
+        }
+    }
+
+    for (const Variant& variant : variants) {
+        CompareResponses(requests, expected, Process(variant, requests), variant.GetName());
+        cout << "OK "sv << variant.GetName() << endl;
+    }
+}
+
+// Длина ломаной одним проходом совпадает с суммой ComputeDistance побитово
+void TestGeo() {
+    mt19937 generator(11);
+    uniform_real_distribution<double> step(-0.01, 0.01);
+    uniform_int_distribution<int> length(0, 40);
+
+    for (int test = 0; test < 2000; ++test) {
+        // Каждый третий путь — из коротких перегонов и повторов точек
+        const double scale = test % 3 == 0 ? 0.001 : 1;
+
+        geo::Coordinates point{55.6 + step(generator) * 100, 37.4 + step(generator) * 100};
+        vector<geo::Coordinates> points;
+        geo::PathPoints path;
+
+        for (int i = length(generator); i > 0; --i) {
+            if (test % 2 == 0 || i % 4 != 0) {
+                point = {point.lat + step(generator) * scale, point.lng + step(generator) * scale};
+            }
+            points.push_back(point);
+            path.Add(point, geo::ComputeLatitudeTrig(point.lat));
+        }
+
+        double expected = 0;
+        for (size_t i = 1; i < points.size(); ++i) {
+            expected += geo::ComputeDistance(points[i - 1], points[i]);
+        }
+
+        Check(geo::ComputePathLength(path) == expected,
+            "ComputePathLength differs from ComputeDistance on path "s + to_string(test));
+    }
+
+    // Статистика автобусов справочника посчитана тем же путём
+    const bench::CityConfig config = MakeCityConfig({});
+    const bench::CityGenerator city(config);
+
+    ostringstream make_text;
+    city.WriteMakeBase(make_text);
+    istringstream make_input(make_text.str());
+
+    transport::TransportCatalogue catalogue;
+    const transport::JsonReader reader(make_input, catalogue);
+
+    for (const transport::Bus& bus : catalogue.GetBuses()) {
+        double geo_length = 0;
+        for (size_t i = 1; i < bus.bus_stops.size(); ++i) {
+            geo_length += geo::ComputeDistance(bus.bus_stops[i - 1]->coordinates, bus.bus_stops[i]->coordinates);
+        }
+        if (!bus.circular) {
+            geo_length *= 2;
+        }
+
+        const transport::BusStat& stat = catalogue.GetBusStatById(bus.id);
+        Check(stat.curvature == stat.length / geo_length, "curvature of "s + bus.name + " differs"s);
+    }
+
+    cout << "OK geo"sv << endl;
+}
+
+void TestRequests() {
+    const Variant reference;
+
+    CheckVariants(reference, {
+        {"protobuf"s, "all_pairs"s, "stop_pairs"s, "full"s, 1},
+        {"protobuf"s, "all_pairs"s, "stop_pairs"s, "graph"s, 1},
+        {"protobuf"s, "all_pairs"s, "stop_pairs"s, "settings"s, 1},
+        {"protobuf"s, "contraction_hierarchy"s, "stop_pairs"s, "full"s, 1},
+        {"protobuf"s, "contraction_hierarchy"s, "stop_pairs"s, "settings"s, 1},
+        {"protobuf"s, "dijkstra"s, "stop_pairs"s, "full"s, 4},
+        {"protobuf"s, "all_pairs"s, "stop_pairs"s, "full"s, 4},
+    });
+}
+
+void TestMapped() {
+    const Variant reference;
+
+    CheckVariants(reference, {
+        {"mapped"s, "dijkstra"s, "stop_pairs"s, "full"s, 1},
+        {"mapped"s, "all_pairs"s, "stop_pairs"s, "full"s, 1},
+        {"mapped"s, "all_pairs"s, "stop_pairs"s, "graph"s, 1},
+        {"mapped"s, "all_pairs"s, "stop_pairs"s, "settings"s, 1},
+        {"mapped"s, "contraction_hierarchy"s, "stop_pairs"s, "full"s, 1},
+        {"mapped"s, "all_pairs"s, "stop_pairs"s, "full"s, 4},
+    });
+}
+
+void TestTransfer() {
+    const Variant reference{"protobuf"s, "dijkstra"s, "transfer"s, "full"s, 1};
+
+    CheckVariants(reference, {
+        {"protobuf"s, "all_pairs"s, "transfer"s, "full"s, 4},
+        {"protobuf"s, "contraction_hierarchy"s, "transfer"s, "full"s, 1},
+        {"mapped"s, "dijkstra"s, "transfer"s, "full"s, 1},
+        {"mapped"s, "all_pairs"s, "transfer"s, "full"s, 1},
+        {"mapped"s, "all_pairs"s, "transfer"s, "settings"s, 4},
+        {"protobuf"s, "dijkstra"s, "transfer"s, "settings"s, 1},
+        {"protobuf"s, "dijkstra"s, "transfer"s, "graph"s, 1},
+    });
+}
+
+// Число записей по типам совпадает с числом запросов, квантили упорядочены
+void TestLatency() {
+    const Variant variant;
+    json::Array requests = GetRequestsForCheck(variant);
+
+    map<string, int> counts;
+    for (const auto& request : requests) {
+        ++counts[request.AsDict().at("type"s).AsString()];
+    }
+
+    requests.push_back(json::Builder{}.StartDict()
+        .Key("id"s).Value(static_cast<int>(requests.size()))
+        .Key("type"s).Value("LatencyStats"s)
+        .Key("buckets"s).Value(true)
+        .EndDict().Build());
+
+    const json::Node responses = Process(variant, requests, [](transport::RequestHandler& handler) {
+        handler.SetLatencyStats(true);
+    });
+
+    const json::Dict& types = responses.AsArray().back().AsDict().at("types"s).AsDict();
+    Check(types.size() == counts.size(), "LatencyStats should report every requested type"s);
+
+    for (const auto& [type, count] : counts) {
+        Check(types.count(type) > 0, "LatencyStats has no "s + type);
+
+        const json::Dict& stats = types.at(type).AsDict();
+        Check(static_cast<int>(stats.at("count"s).AsDouble()) == count, "LatencyStats count of "s + type + " differs"s);
+
+        const double p50 = stats.at("p50_ms"s).AsDouble();
+        const double p99 = stats.at("p99_ms"s).AsDouble();
+        const double p999 = stats.at("p999_ms"s).AsDouble();
+        const double max_ms = stats.at("max_ms"s).AsDouble();
+        Check(p50 <= p99 && p99 <= p999 && p999 <= max_ms && stats.at("mean_ms"s).AsDouble() <= max_ms,
+            "LatencyStats quantiles of "s + type + " are out of order"s);
+
+        int buckets_count = 0;
+        for (const auto& bucket : stats.at("buckets"s).AsArray()) {
+            buckets_count += static_cast<int>(bucket.AsArray()[2].AsDouble());
+        }
+        Check(buckets_count == count, "LatencyStats buckets of "s + type + " don't add up"s);
+    }
+
+    cout << "OK latency"sv << endl;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    const map<string_view, function<void()>> tests = {
+        {"geo"sv, TestGeo},
+        {"requests"sv, TestRequests},
+        {"mapped"sv, TestMapped},
+        {"transfer"sv, TestTransfer},
+        {"latency"sv, TestLatency},
+    };
+
+    if (argc != 2 || tests.count(argv[1]) == 0) {
+        cerr << "Usage: golden_test geo|requests|mapped|transfer|latency"sv << endl;
+        return 1;
+    }
+
+    try {
+        tests.at(argv[1])();
+    } catch (const exception& e) {
+        cerr << "FAILED "sv << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
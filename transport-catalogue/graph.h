@@ -28,6 +28,8 @@ public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    // Выделяет память под рёбра заранее: out_degrees[v] — сколько рёбер ещё выйдет из v
+    void ReserveEdges(const std::vector<size_t>& out_degrees);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
@@ -57,6 +59,19 @@ EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::ReserveEdges(const std::vector<size_t>& out_degrees) {
+    size_t edge_count = 0;
+
+    for (VertexId vertex = 0; vertex < out_degrees.size(); ++vertex) {
+        IncidenceList& incidence_list = incidence_lists_.at(vertex);
+        incidence_list.reserve(incidence_list.size() + out_degrees[vertex]);
+        edge_count += out_degrees[vertex];
+    }
+
+    edges_.reserve(edges_.size() + edge_count);
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
     return incidence_lists_.size();
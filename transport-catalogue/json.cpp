@@ -1,5 +1,7 @@
+#include <charconv>
 #include <sstream>
 #include <iomanip>
+#include <string_view>
 
 #include "json.h"
 
@@ -9,193 +11,300 @@ namespace json {
 
 namespace {
 
-Node LoadNode(istream& input);
-    
-Node LoadArray(istream& input) {
-    Array result;
-    char c;
-
-    while (input >> c) {
-        if ( c == ']') {
-            break;
-        }
-        
-        if (c != ',') {
-            input.putback(c);
-        }
-        
-        result.push_back(LoadNode(input));
+// Читает символы прямо из буфера потока, минуя форматированный ввод istream
+class Parser {
+public:
+    Parser(istream& input, Handler& handler)
+        : buffer_(*input.rdbuf())
+        , handler_(handler) {
     }
-    
-    if (c != ']') {
-        throw ParsingError{"no closing bracket in array"s};
-    }
-    
-    return Node(move(result));
-}
 
-string LoadLexeme(istream& input) {
-    stringstream dst;
-    char c;
-    
-    while (input.peek() != '}' 
-        && input.peek() != ']' 
-        && input.peek() != ' '
-        && input.peek() != ','
-        && input.peek() != '\r'
-        && input.peek() != '\n'
-        && input.peek() != '\t'
-        && input.peek() != EOF) {
-        
-        c = input.get();
-        dst << c;
+    void ParseDocument() {
+        ParseValue();
     }
-    
-    return dst.str();
-}
-    
-Node LexemeToNode(const string& lex) {
-    if (lex == "null"s) {
-        return Node{nullptr};
-    }
-    
-    if (lex == "true"s) {
-        return Node{true};
+
+private:
+    static constexpr int END = char_traits<char>::eof();
+
+    int Peek() {
+        return buffer_.sgetc();
     }
-    
-    if (lex == "false"s) {
-        return  Node{false};
+
+    int Get() {
+        return buffer_.sbumpc();
     }
-    
-    bool is_double = false;
-    double double_res;
-    
-    if (lex.find('.') != lex.npos 
-        || lex.find('E') != lex.npos 
-        || lex.find('e') != lex.npos) {
-        
-        try {
-            double_res = stod(lex);
-            is_double = true;
-        } catch (...) {
-            throw ParsingError{"undefined lexeme"s};
+
+    // Пропускает пробельные символы и возвращает следующий символ, не извлекая его
+    int PeekNonSpace() {
+        int c = Peek();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v') {
+            buffer_.sbumpc();
+            c = Peek();
         }
+        return c;
     }
-    
-    if (is_double) {
-        return Node{double_res};
+
+    void ParseValue() {
+        const int c = PeekNonSpace();
+
+        if (c == '[') {
+            Get();
+            ParseArray();
+        } else if (c == '{') {
+            Get();
+            ParseDict();
+        } else if (c == '"') {
+            Get();
+            handler_.String(ParseString());
+        } else if (c == END) {
+            throw ParsingError{"unexpected end of input"s};
+        } else {
+            ParseLexeme();
+        }
     }
-    
-    int int_res;
-    
-    try {
-        int_res = stoi(lex);
-    } catch (...) {
-        throw ParsingError{"undefined lexeme"s};
+
+    void ParseArray() {
+        handler_.StartArray();
+
+        if (PeekNonSpace() == ']') {
+            Get();
+            handler_.EndArray();
+            return;
+        }
+
+        while (true) {
+            ParseValue();
+
+            const int c = PeekNonSpace();
+            Get();
+
+            if (c == ']') {
+                break;
+            }
+            if (c != ',') {
+                throw ParsingError{"no closing bracket in array"s};
+            }
+        }
+
+        handler_.EndArray();
     }
-    
-    return Node{int_res};
-}
 
-Node LoadString(istream& input) {
-    
-    stringstream dst;
-    bool escape = false;
-    char c;
-    
-    while (input.peek() != '"' || escape) {
-        c = input.get();
-        
-        if (input.eof()) {
-            throw ParsingError{"no ending quote in string"s};
+    void ParseDict() {
+        handler_.StartDict();
+
+        if (PeekNonSpace() == '}') {
+            Get();
+            handler_.EndDict();
+            return;
         }
-        
-        if (c == '\\' && !escape) {
-            escape = true;
-            continue;
+
+        while (true) {
+            if (PeekNonSpace() != '"') {
+                throw ParsingError{"no key in dict"s};
+            }
+            Get();
+            handler_.Key(ParseString());
+
+            if (PeekNonSpace() != ':') {
+                throw ParsingError{"no colon after key in dict"s};
+            }
+            Get();
+
+            ParseValue();
+
+            const int c = PeekNonSpace();
+            Get();
+
+            if (c == '}') {
+                break;
+            }
+            if (c != ',') {
+                throw ParsingError{"no closing bracket in dict"s};
+            }
         }
-        
-        if (escape && c == 'n') {
-            dst << '\n';
-        } else if (escape && c == 'r') {
-            dst << '\r';
-        } else if (escape && c == 't') {
-            dst << '\t';
-        } else if (escape && c == '"') {
-            dst << '"';
-        } else if (escape && c == '\\') {
-            dst << '\\';
-        } else {
-            if (escape) {
-               throw ParsingError{"wrong escape sequence"s};
+
+        handler_.EndDict();
+    }
+
+    string ParseString() {
+        string result;
+
+        while (true) {
+            int c = Get();
+
+            if (c == END) {
+                throw ParsingError{"no ending quote in string"s};
+            }
+
+            if (c == '"') {
+                break;
+            }
+
+            if (c == '\\') {
+                c = Get();
+
+                switch (c) {
+                    case 'n': result.push_back('\n'); break;
+                    case 'r': result.push_back('\r'); break;
+                    case 't': result.push_back('\t'); break;
+                    case '"': result.push_back('"'); break;
+                    case '\\': result.push_back('\\'); break;
+                    default: throw ParsingError{"wrong escape sequence"s};
+                }
+            } else {
+                result.push_back(static_cast<char>(c));
             }
-            
-            dst <<  c;
         }
-        
-        escape = false;
+
+        return result;
     }
-    
-    input.get(); //remove closing quote 
-    
-    return Node(move(dst.str()));
-}
 
-Node LoadDict(istream& input) {
-    Dict result;
-    char c;
+    void ParseLexeme() {
+        lexeme_.clear();
 
-    while (input >> c) {
-        if (c == '}') {
-            break;
+        for (int c = Peek();
+             c != '}' && c != ']' && c != ',' && c != ' '
+             && c != '\r' && c != '\n' && c != '\t' && c != END;
+             c = Peek()) {
+            lexeme_.push_back(static_cast<char>(Get()));
         }
-        
-        if (c == ',') {
-            input >> c;
+
+        if (lexeme_ == "null"sv) {
+            handler_.Null();
+        } else if (lexeme_ == "true"sv) {
+            handler_.Bool(true);
+        } else if (lexeme_ == "false"sv) {
+            handler_.Bool(false);
+        } else if (lexeme_.find_first_of(".eE"sv) != string::npos) {
+            handler_.Double(ParseNumber<double>());
+        } else {
+            handler_.Int(ParseNumber<int>());
+        }
+    }
+
+    template <typename Number>
+    Number ParseNumber() const {
+        Number result{};
+        const char* end = lexeme_.data() + lexeme_.size();
+        const auto [ptr, error] = from_chars(lexeme_.data(), end, result);
+
+        if (error != errc{} || ptr != end) {
+            throw ParsingError{"undefined lexeme"s};
         }
 
-        string key = LoadString(input).AsString();
-        input >> c;
-        result.insert({move(key), LoadNode(input)});
+        return result;
     }
-    
-    if (c !=  '}') {
-        throw ParsingError{"no closing bracket in dict"s};
+
+    streambuf& buffer_;
+    Handler& handler_;
+    string lexeme_;
+};
+
+// Собирает документ из событий разбора
+class DocumentHandler final : public Handler {
+public:
+    void Null() override {
+        AddValue(Node{nullptr});
     }
 
-    return Node(move(result));
-}
+    void Bool(bool value) override {
+        AddValue(Node{value});
+    }
 
-Node LoadNode(istream& input) {
-    char c;
-    input >> c;
+    void Int(int value) override {
+        AddValue(Node{value});
+    }
 
-    if (c == '[') {
-        return LoadArray(input);
-    } else if (c == '{') {
-        return LoadDict(input);
-    } else if (c == '"') {
-        return LoadString(input);
-    } else {
-        input.putback(c);
-        return LexemeToNode(LoadLexeme(input));
+    void Double(double value) override {
+        AddValue(Node{value});
     }
-}
-    
-std::string escape(std::string_view src) {
-    std::stringstream dst;
-    for (char ch : src) {
-        switch (ch) {
-            case '\n': dst << '\\' << 'n'; break;
-            case '\r': dst << '\\' << 'r'; break;
-            case '"': dst << '\\' << '"'; break;
-            case '\\': dst << '\\' << '\\'; break;
-            default: dst << ch; break;
+
+    void String(string&& value) override {
+        AddValue(Node{move(value)});
+    }
+
+    void StartArray() override {
+        containers_.emplace_back();
+    }
+
+    void EndArray() override {
+        Node array{move(containers_.back().array)};
+        containers_.pop_back();
+        AddValue(move(array));
+    }
+
+    void StartDict() override {
+        containers_.emplace_back();
+        containers_.back().is_dict = true;
+    }
+
+    void Key(string&& key) override {
+        containers_.back().key = move(key);
+    }
+
+    void EndDict() override {
+        Node dict{move(containers_.back().dict)};
+        containers_.pop_back();
+        AddValue(move(dict));
+    }
+
+    Node ExtractRoot() {
+        return move(root_);
+    }
+
+private:
+    // Открытый массив или словарь и последний прочитанный в нём ключ
+    struct Container {
+        bool is_dict = false;
+        Array array;
+        Dict dict;
+        string key;
+    };
+
+    void AddValue(Node value) {
+        if (containers_.empty()) {
+            root_ = move(value);
+        } else if (containers_.back().is_dict) {
+            containers_.back().dict.emplace(move(containers_.back().key), move(value));
+        } else {
+            containers_.back().array.push_back(move(value));
         }
     }
-    return dst.str();
+
+    vector<Container> containers_;
+    Node root_;
+};
+
+// Пишет строку в кавычках, экранируя спецсимволы; куски без них
+// выводятся целиком, без промежуточной строки
+void PrintString(std::string_view src, std::ostream& output) {
+    output << '"';
+
+    size_t begin = 0;
+    for (size_t pos = 0; pos < src.size(); ++pos) {
+        const char ch = src[pos];
+
+        if (ch != '\n' && ch != '\r' && ch != '"' && ch != '\\') {
+            continue;
+        }
+
+        output.write(src.data() + begin, pos - begin);
+        output << '\\' << (ch == '\n' ? 'n' : ch == '\r' ? 'r' : ch);
+        begin = pos + 1;
+    }
+    output.write(src.data() + begin, src.size() - begin);
+
+    output << '"';
 }
-    
+
+void PrintIndent(std::ostream& output, int count) {
+    for (int i = 0; i < count; ++i) {
+        output << ' ';
+    }
+}
+
+void PrintNode(const Node& node, std::ostream& output, int indent_size, int indent_step);
+
 void PrintArray(const Array& arr, std::ostream& output, 
     int indent_size, int indent_step) {
     
@@ -208,10 +317,7 @@ void PrintArray(const Array& arr, std::ostream& output,
             output << ' '; 
         }
 
-        Print(Document{node},  
-              output, 
-              indent_size, 
-              indent_step + 1);
+        PrintNode(node, output, indent_size, indent_step + 1);
 
         if (index < arr.size() - 1) {
             output << ',';
@@ -242,10 +348,7 @@ void PrintDict(const Dict& dict, std::ostream& output,
         
         output << '"' << key << '"' << ": ";
 
-        Print(Document{node},  
-              output, 
-              indent_size, 
-              indent_step + 1);
+        PrintNode(node, output, indent_size, indent_step + 1);
 
         if (index < dict.size() - 1) {
             output << ',';
@@ -262,6 +365,24 @@ void PrintDict(const Dict& dict, std::ostream& output,
     output << '}';
 }
 
+void PrintNode(const Node& node, std::ostream& output, int indent_size, int indent_step) {
+    if (node.IsNull()) {
+        output << "null"s;
+    } else if (node.IsString()) {
+        PrintString(node.AsString(), output);
+    } else if (node.IsInt()) {
+        output << node.AsInt();
+    } else if (node.IsDouble()) {
+        output << node.AsDouble();
+    } else if (node.IsBool()) {
+        output << boolalpha << node.AsBool();
+    } else if (node.IsArray()) {
+        PrintArray(node.AsArray(), output, indent_size, indent_step);
+    } else if (node.IsDict()) {
+        PrintDict(node.AsDict(), output, indent_size, indent_step);
+    }
+}
+
 }  // namespace
 
 bool Node::IsNull() const {
@@ -363,8 +484,14 @@ const Node& Document::GetRoot() const {
     return root_;
 }
 
+void Parse(istream& input, Handler& handler) {
+    Parser(input, handler).ParseDocument();
+}
+
 Document Load(istream& input) {
-    return Document{LoadNode(input)};
+    DocumentHandler handler;
+    Parse(input, handler);
+    return Document{handler.ExtractRoot()};
 }
 
 bool Document::operator==(const Document& rhs ) const {
@@ -378,25 +505,145 @@ bool Document::operator!=(const Document& rhs ) const {
 void Print(const Document& doc, std::ostream& output, 
     int indent_size, int indent_step) {
 
-    const Node& root = doc.GetRoot();
-    
-    if (root.IsNull()) {
-        output << "null"s;
-    } else if (root.IsString()) {
-        output << '"' << escape(root.AsString()) << '"';
-    } else if (root.IsInt()) {
-        output << root.AsInt();
-    } else if (root.IsDouble()) {
-        output << root.AsDouble();
-    } else if (root.IsBool()) {
-        output << boolalpha << root.AsBool();
-    } else if (root.IsArray()) {
-        const Array& arr = root.AsArray();
-        PrintArray(arr, output, indent_size, indent_step);
-    } else if (root.IsDict()) {
-        const Dict& dict = root.AsDict();
-        PrintDict(dict, output, indent_size, indent_step);
+    PrintNode(doc.GetRoot(), output, indent_size, indent_step);
+}
+
+Writer::Writer(std::ostream& output, int indent_size, int indent_step)
+    : output_(output)
+    , indent_size_(indent_size)
+    , indent_step_(indent_step) {
+}
+
+void Writer::BeginValue() {
+    if (levels_.empty()) {
+        return;
+    }
+
+    Level& level = levels_.back();
+
+    if (level.is_dict) {
+        if (!level.has_key) {
+            throw logic_error("no key in dict"s);
+        }
+        level.has_key = false;
+        return;
+    }
+
+    if (level.count++ > 0) {
+        output_ << ",\n"s;
+    }
+    PrintIndent(output_, indent_size_ * GetIndentStep());
+}
+
+int Writer::GetIndentStep() const {
+    return indent_step_ + static_cast<int>(levels_.size()) - 1;
+}
+
+Writer& Writer::StartArray() {
+    BeginValue();
+    output_ << "[\n"s;
+    levels_.push_back(Level{});
+    return *this;
+}
+
+Writer& Writer::StartDict() {
+    BeginValue();
+    output_ << "{\n"s;
+    levels_.push_back(Level{true});
+    return *this;
+}
+
+Writer& Writer::EndArray() {
+    if (levels_.empty() || levels_.back().is_dict) {
+        throw logic_error("no opened array"s);
+    }
+    EndContainer(']');
+    return *this;
+}
+
+Writer& Writer::EndDict() {
+    if (levels_.empty() || !levels_.back().is_dict || levels_.back().has_key) {
+        throw logic_error("no opened dict"s);
+    }
+    EndContainer('}');
+    return *this;
+}
+
+void Writer::EndContainer(char bracket) {
+    if (levels_.back().count > 0) {
+        output_ << '\n';
+    }
+    levels_.pop_back();
+
+    PrintIndent(output_, indent_size_ * GetIndentStep());
+    output_ << bracket;
+}
+
+Writer& Writer::Key(std::string_view key) {
+    if (levels_.empty() || !levels_.back().is_dict || levels_.back().has_key) {
+        throw logic_error("key outside of dict"s);
     }
+
+    Level& level = levels_.back();
+
+    if (level.count++ > 0) {
+        output_ << ",\n"s;
+    }
+    level.has_key = true;
+
+    PrintIndent(output_, indent_size_ * GetIndentStep());
+    output_ << '"' << key << "\": "s;
+    return *this;
+}
+
+Writer& Writer::Value(std::nullptr_t) {
+    BeginValue();
+    output_ << "null"s;
+    return *this;
+}
+
+Writer& Writer::Value(bool value) {
+    BeginValue();
+    output_ << boolalpha << value;
+    return *this;
+}
+
+Writer& Writer::Value(int value) {
+    BeginValue();
+    output_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(double value) {
+    BeginValue();
+    output_ << value;
+    return *this;
+}
+
+Writer& Writer::Value(std::string_view value) {
+    BeginValue();
+    PrintString(value, output_);
+    return *this;
+}
+
+Writer& Writer::Value(const char* value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::Value(const std::string& value) {
+    return Value(std::string_view(value));
+}
+
+Writer& Writer::RawValue(std::string_view json) {
+    BeginValue();
+    output_ << json;
+    return *this;
+}
+
+Writer& Writer::Value(const Node& node) {
+    BeginValue();
+    PrintNode(node, output_, indent_size_, GetIndentStep() + 1);
+    return *this;
 }
 
 }  // namespace json
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -62,7 +63,74 @@ private:
 
 Document Load(std::istream& input);
 
+// Обработчик потокового (SAX) разбора: парсер не строит документ, а сообщает
+// о каждом прочитанном элементе. Строки и ключи передаются во владение обработчику
+class Handler {
+public:
+    virtual ~Handler() = default;
+
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    virtual void String(std::string&& value) = 0;
+
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void StartDict() = 0;
+    virtual void Key(std::string&& key) = 0;
+    virtual void EndDict() = 0;
+};
+
+// Разбирает один JSON-документ из input, вызывая методы handler.
+// Load строит документ через этот же разбор, поэтому для больших входных
+// данных выгоднее обрабатывать события сразу, не материализуя дерево
+void Parse(std::istream& input, Handler& handler);
+
 void Print(const Document& doc, std::ostream& output, 
     int indent_size = 2, int indent_step = 1);
 
+// Потоковая запись в том же формате, что и Print: значения сразу уходят
+// в поток, документ не строится. Print выводит ключи словаря по возрастанию
+// (Dict — std::map), поэтому для совпадения вывода ключи нужно передавать
+// в том же порядке
+class Writer {
+public:
+    explicit Writer(std::ostream& output, int indent_size = 2, int indent_step = 1);
+
+    Writer& StartArray();
+    Writer& EndArray();
+    Writer& StartDict();
+    Writer& Key(std::string_view key);
+    Writer& EndDict();
+
+    Writer& Value(std::nullptr_t);
+    Writer& Value(bool value);
+    Writer& Value(int value);
+    Writer& Value(double value);
+    Writer& Value(std::string_view value);
+    Writer& Value(const char* value);
+    Writer& Value(const std::string& value);
+    Writer& Value(const Node& node);
+    // Вставляет уже записанное значение как есть, например подготовленное
+    // другим Writer с indent_step на уровень глубже
+    Writer& RawValue(std::string_view json);
+
+private:
+    struct Level {
+        bool is_dict = false;
+        bool has_key = false;
+        size_t count = 0;
+    };
+
+    void BeginValue();
+    void EndContainer(char bracket);
+    int GetIndentStep() const;
+
+    std::ostream& output_;
+    int indent_size_;
+    int indent_step_;
+    std::vector<Level> levels_;
+};
+
 }  // namespace json
\ No newline at end of file
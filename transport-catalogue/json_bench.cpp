@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "bench_utils.h"
+#include "json.h"
+#include "json_view.h"
+
+// Скорость разбора JSON: json::Load (дерево со std::string и std::map),
+// json::view::Load (один буфер и string_view) и json::Parse с пустым
+// обработчиком — та же лексика без построения дерева, как при потоковом
+// разборе base_requests в JsonReader.
+// Usage: json_bench [file.json] [repetitions]
+// Без файла разбирается сгенерированный документ в формате запросов make_base
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+string MakeDocument(int stops_count, int buses_count) {
+    mt19937 generator(42);
+    uniform_real_distribution<double> lat(55.5, 55.9);
+    uniform_real_distribution<double> lng(37.3, 37.9);
+    uniform_int_distribution<int> stop_index(0, stops_count - 1);
+    uniform_int_distribution<int> distance(100, 5000);
+
+    auto stop_name = [](int index) {
+        // Каждое десятое название с кавычками, чтобы разбор проходил и медленный путь
+        return index % 10 == 0 ? "Stop \\\"" + to_string(index) + "\\\""s : "Stop "s + to_string(index);
+    };
+
+    ostringstream out;
+    out.precision(8);
+    out << "{\n  \"base_requests\": [\n"sv;
+
+    for (int i = 0; i < stops_count; ++i) {
+        out << "    {\"type\": \"Stop\", \"name\": \""sv << stop_name(i)
+            << "\", \"latitude\": "sv << lat(generator) << ", \"longitude\": "sv << lng(generator)
+            << ", \"road_distances\": {"sv;
+
+        for (int j = 0; j < 5; ++j) {
+            out << (j > 0 ? ", "sv : ""sv) << '"' << stop_name(stop_index(generator)) << "\": "sv
+                << distance(generator);
+        }
+        out << "}},\n"sv;
+    }
+
+    for (int i = 0; i < buses_count; ++i) {
+        out << "    {\"type\": \"Bus\", \"name\": \"Bus "sv << i << "\", \"is_roundtrip\": "sv
+            << (i % 2 == 0 ? "true"sv : "false"sv) << ", \"stops\": ["sv;
+
+        for (int j = 0; j < 30; ++j) {
+            out << (j > 0 ? ", "sv : ""sv) << '"' << stop_name(stop_index(generator)) << '"';
+        }
+        out << "]}"sv << (i + 1 < buses_count ? ",\n"sv : "\n"sv);
+    }
+
+    out << "  ],\n  \"routing_settings\": {\"bus_wait_time\": 6, \"bus_velocity\": 40}\n}\n"sv;
+
+    return out.str();
+}
+
+// Считает события разбора, ничего не сохраняя
+class CountingHandler final : public json::Handler {
+public:
+    void Null() override { ++events_; }
+    void Bool(bool) override { ++events_; }
+    void Int(int) override { ++events_; }
+    void Double(double) override { ++events_; }
+    void String(string&&) override { ++events_; }
+    void StartArray() override { ++events_; }
+    void EndArray() override { ++events_; }
+    void StartDict() override { ++events_; }
+    void Key(string&&) override { ++events_; }
+    void EndDict() override { ++events_; }
+
+    size_t GetEvents() const {
+        return events_;
+    }
+
+private:
+    size_t events_ = 0;
+};
+
+// Лучшее из repetitions время одного разбора, в секундах
+template <typename ParseFunction>
+double MeasureBest(int repetitions, ParseFunction parse) {
+    double best = numeric_limits<double>::max();
+
+    for (int i = 0; i < repetitions; ++i) {
+        const auto start = chrono::steady_clock::now();
+        parse();
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    string text;
+
+    if (argc > 1) {
+        ifstream input(argv[1], ios::binary);
+
+        if (!input) {
+            cerr << "Can't open "sv << argv[1] << endl;
+            return 1;
+        }
+        text.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    } else {
+        text = MakeDocument(20000, 2000);
+    }
+
+    const int repetitions = argc > 2 ? stoi(argv[2]) : 5;
+    const double megabytes = static_cast<double>(text.size()) / (1 << 20);
+
+    // Оба дерева должны описывать один и тот же документ
+    {
+        istringstream load_input(text);
+        istringstream view_input(text);
+
+        if (json::Load(load_input).GetRoot() != json::view::Load(view_input).GetRoot().ToNode()) {
+            cerr << "Parsers disagree on the input"sv << endl;
+            return 1;
+        }
+    }
+
+    const double load_seconds = MeasureBest(repetitions, [&text] {
+        istringstream input(text);
+        bench::DoNotOptimize(json::Load(input));
+    });
+
+    const double view_seconds = MeasureBest(repetitions, [&text] {
+        istringstream input(text);
+        bench::DoNotOptimize(json::view::Load(input));
+    });
+
+    const double parse_seconds = MeasureBest(repetitions, [&text] {
+        istringstream input(text);
+        CountingHandler handler;
+        json::Parse(input, handler);
+        bench::DoNotOptimize(handler.GetEvents());
+    });
+
+    cout << "input: "sv << megabytes << " MB, best of "sv << repetitions << '\n';
+    cout << "json::Load:                  "sv << megabytes / load_seconds << " MB/s\n"sv;
+    cout << "json::view::Load:            "sv << megabytes / view_seconds << " MB/s\n"sv;
+    cout << "json::Parse, empty handler:  "sv << megabytes / parse_seconds << " MB/s\n"sv;
+
+    return 0;
+}
@@ -1,14 +1,205 @@
 #include "json_reader.h"
+#include "json_builder.h"
+#include "profile.h"
 
 using namespace std;
 
 namespace transport {
 
-JsonReader::JsonReader(std::istream& input) : json_doc_(json::Load(input)) {
+namespace {
 
+// Обработчик потокового разбора входного документа: элементы base_requests
+// разбираются в parsed::Stop, parsed::Distances и parsed::Bus без построения
+// узлов, все остальные разделы собираются в документ через json::Builder
+class BaseRequestsHandler final : public json::Handler {
+public:
+    explicit BaseRequestsHandler(TransportCatalogue& catalogue) : catalogue_(catalogue) {
+    }
+
+    void Null() override {
+        if (!IsStreaming()) {
+            builder_.Value(nullptr);
+        }
+    }
+
+    void Bool(bool value) override {
+        if (!IsStreaming()) {
+            builder_.Value(value);
+        } else if (depth_ == REQUEST_DEPTH && field_ == "is_roundtrip"sv) {
+            bus_.circular = value;
+        }
+    }
+
+    void Int(int value) override {
+        if (!IsStreaming()) {
+            builder_.Value(value);
+        } else if (depth_ == FIELD_DEPTH && field_ == "road_distances"sv) {
+            distances_.d_map.emplace(move(distance_to_), value);
+        } else {
+            Double(value);
+        }
+    }
+
+    void Double(double value) override {
+        if (!IsStreaming()) {
+            builder_.Value(value);
+        } else if (depth_ == FIELD_DEPTH && field_ == "road_distances"sv) {
+            // Расстояния — целые метры, как и при разборе через AsInt
+            throw json::ParsingError("road distance to "s + distance_to_ + " should be an integer"s);
+        } else if (depth_ == REQUEST_DEPTH && field_ == "latitude"sv) {
+            stop_.lat = value;
+        } else if (depth_ == REQUEST_DEPTH && field_ == "longitude"sv) {
+            stop_.lng = value;
+        }
+    }
+
+    void String(string&& value) override {
+        if (!IsStreaming()) {
+            builder_.Value(move(value));
+        } else if (depth_ == REQUEST_DEPTH && field_ == "type"sv) {
+            type_ = move(value);
+        } else if (depth_ == REQUEST_DEPTH && field_ == "name"sv) {
+            stop_.name = move(value);
+        } else if (depth_ == FIELD_DEPTH && field_ == "stops"sv) {
+            bus_.stops.push_back(move(value));
+        }
+    }
+
+    void StartArray() override {
+        ++depth_;
+        if (!in_base_requests_) {
+            builder_.StartArray();
+        }
+    }
+
+    void EndArray() override {
+        if (!in_base_requests_) {
+            builder_.EndArray();
+        } else if (depth_ == BASE_REQUESTS_DEPTH) {
+            in_base_requests_ = false;
+        }
+        --depth_;
+    }
+
+    void StartDict() override {
+        const bool is_streaming = IsStreaming();
+        ++depth_;
+        if (!is_streaming) {
+            builder_.StartDict();
+        } else if (depth_ == REQUEST_DEPTH) {
+            type_.clear();
+            stop_ = parsed::Stop{};
+            distances_.d_map.clear();
+            bus_ = parsed::Bus{};
+        }
+    }
+
+    void Key(string&& key) override {
+        if (!in_base_requests_) {
+            if (depth_ == 1 && key == "base_requests"sv) {
+                in_base_requests_ = true;
+            } else {
+                builder_.Key(move(key));
+            }
+        } else if (depth_ == REQUEST_DEPTH) {
+            field_ = move(key);
+        } else if (depth_ == FIELD_DEPTH) {
+            distance_to_ = move(key);
+        }
+    }
+
+    void EndDict() override {
+        if (!in_base_requests_) {
+            builder_.EndDict();
+        } else if (depth_ == REQUEST_DEPTH) {
+            AddRequest();
+        }
+        --depth_;
+    }
+
+    // Добавляет в справочник отложенные расстояния и автобусы
+    // и возвращает документ без base_requests
+    json::Document Finish() {
+        for (const auto& d : add_dists_deferred_) {
+            catalogue_.AddDistances(d);
+        }
+
+        for (const auto& bus : add_bus_deferred_) {
+            catalogue_.AddBus(bus);
+        }
+
+        return json::Document{builder_.Build()};
+    }
+
+private:
+    static constexpr int BASE_REQUESTS_DEPTH = 2;
+    static constexpr int REQUEST_DEPTH = 3;
+    static constexpr int FIELD_DEPTH = 4;
+
+    // Значение base_requests должно быть массивом, иначе разбирать нечего
+    bool IsStreaming() const {
+        if (in_base_requests_ && depth_ == 1) {
+            throw invalid_argument("base_requests should be an array"s);
+        }
+        return in_base_requests_;
+    }
+
+    void AddRequest() {
+        if (type_ == "Stop"s) {
+            if (distances_.d_map.size() > 0) {
+                distances_.from = stop_.name;
+                add_dists_deferred_.push_back(move(distances_));
+            }
+
+            catalogue_.AddStop(stop_);
+        } else if (type_ == "Bus"s) {
+            bus_.name = move(stop_.name);
+            add_bus_deferred_.push_back(move(bus_));
+        } else {
+            throw invalid_argument("wrong query to catalogue"s);
+        }
+    }
+
+    TransportCatalogue& catalogue_;
+    json::Builder builder_;
+
+    int depth_ = 0;
+    bool in_base_requests_ = false;
+
+    // Текущий элемент base_requests: поля могут идти в любом порядке,
+    // поэтому тип запроса становится известен только в конце словаря
+    string type_;
+    string field_;
+    string distance_to_;
+    parsed::Stop stop_;
+    parsed::Distances distances_;
+    parsed::Bus bus_;
+
+    vector<parsed::Bus> add_bus_deferred_;
+    vector<parsed::Distances> add_dists_deferred_;
+};
+
+} // namespace
+
+JsonReader::JsonReader(std::istream& input) {
+    profile::ScopedTimer timer("json::Load"sv);
+    json_doc_ = json::Load(input);
+}
+
+JsonReader::JsonReader(std::istream& input, TransportCatalogue& catalogue) {
+    // Разбор и заполнение справочника идут одним проходом, поэтому и замер общий
+    profile::ScopedTimer timer("json::Parse with FillCatalogue"sv);
+
+    BaseRequestsHandler handler(catalogue);
+    json::Parse(input, handler);
+    json_doc_ = handler.Finish();
+    is_base_requests_consumed_ = true;
 }
 
 const json::Array& JsonReader::GetBaseRequests() const {
+    if (is_base_requests_consumed_) {
+        throw logic_error("base_requests were already added to the catalogue while parsing"s);
+    }
     return json_doc_.GetRoot().AsDict().at("base_requests"s).AsArray();
 }
 
@@ -20,28 +211,119 @@ bool JsonReader::HasRenderSettings() const {
     return json_doc_.GetRoot().AsDict().count("render_settings"s) > 0;
 }
 
+bool JsonReader::HasStatRequests() const {
+    return json_doc_.GetRoot().AsDict().count("stat_requests"s) > 0;
+}
+
 const json::Array& JsonReader::GetStatRequests() const {
     return json_doc_.GetRoot().AsDict().at("stat_requests"s).AsArray();
 }
 
 route::RouteSettings JsonReader::GetRouteSettings() const {
-    const json::Dict& settings =  json_doc_.GetRoot().AsDict().at("routing_settings"s).AsDict();
-
-    return {settings.at("bus_wait_time").AsInt(), settings.at("bus_velocity").AsInt()};
+    return DictToRouteSettings(json_doc_.GetRoot().AsDict().at("routing_settings"s).AsDict());
 }
 
 optional<route::RouteSettings> JsonReader::GetRouteSettingsOpt() const {
     if (json_doc_.GetRoot().AsDict().count("routing_settings"s) > 0) {
-        const json::Dict& settings =  json_doc_.GetRoot().AsDict().at("routing_settings"s).AsDict();
-
-        return route::RouteSettings{settings.at("bus_wait_time").AsInt(), settings.at("bus_velocity").AsInt()};
+        return DictToRouteSettings(json_doc_.GetRoot().AsDict().at("routing_settings"s).AsDict());
     }
 
     return {};
 }
 
+route::RouteSettings JsonReader::DictToRouteSettings(const json::Dict& settings_dict) const {
+    route::RouteSettings settings;
+
+    settings.bus_wait_time = settings_dict.at("bus_wait_time"s).AsInt();
+    settings.bus_velocity = settings_dict.at("bus_velocity"s).AsInt();
+
+    if (settings_dict.count("router_mode"s) > 0) {
+        const string& mode = settings_dict.at("router_mode"s).AsString();
+
+        if (mode == "all_pairs"s) {
+            settings.mode = route::RouterMode::ALL_PAIRS;
+        } else if (mode == "dijkstra"s) {
+            settings.mode = route::RouterMode::DIJKSTRA;
+        } else if (mode == "contraction_hierarchy"s) {
+            settings.mode = route::RouterMode::CONTRACTION_HIERARCHY;
+        } else {
+            throw invalid_argument("wrong router mode"s);
+        }
+    }
+
+    if (settings_dict.count("walk_velocity"s) > 0) {
+        settings.walk_velocity = settings_dict.at("walk_velocity"s).AsDouble();
+    }
+
+    if (settings_dict.count("max_walk_distance"s) > 0) {
+        settings.max_walk_distance = settings_dict.at("max_walk_distance"s).AsDouble();
+    }
+
+    if (settings_dict.count("graph_model"s) > 0) {
+        const string& model = settings_dict.at("graph_model"s).AsString();
+
+        if (model == "stop_pairs"s) {
+            settings.graph_model = route::GraphModel::STOP_PAIRS;
+        } else if (model == "transfer"s) {
+            settings.graph_model = route::GraphModel::TRANSFER;
+        } else {
+            throw invalid_argument("wrong graph model"s);
+        }
+    }
+
+    return settings;
+}
+
 serialize::Settings JsonReader::GetSerializeSettings() const {
-    return {json_doc_.GetRoot().AsDict().at("serialization_settings"s).AsDict().at("file").AsString()};
+    const json::Dict& settings_dict = json_doc_.GetRoot().AsDict().at("serialization_settings"s).AsDict();
+
+    serialize::Settings settings;
+    settings.file = settings_dict.at("file"s).AsString();
+
+    if (settings_dict.count("threads"s) > 0) {
+        const int threads = settings_dict.at("threads"s).AsInt();
+
+        if (threads < 0) {
+            throw invalid_argument("wrong threads count"s);
+        }
+        settings.threads = static_cast<size_t>(threads);
+    }
+
+    if (settings_dict.count("router_storage"s) > 0) {
+        const string& storage = settings_dict.at("router_storage"s).AsString();
+
+        if (storage == "full"s) {
+            settings.router_storage = serialize::RouterStorage::FULL;
+        } else if (storage == "graph"s) {
+            settings.router_storage = serialize::RouterStorage::GRAPH;
+        } else if (storage == "settings"s) {
+            settings.router_storage = serialize::RouterStorage::SETTINGS;
+        } else {
+            throw invalid_argument("wrong router storage"s);
+        }
+    }
+
+    if (settings_dict.count("format"s) > 0) {
+        const string& format = settings_dict.at("format"s).AsString();
+
+        if (format == "protobuf"s) {
+            settings.format = serialize::BaseFormat::PROTOBUF;
+        } else if (format == "mapped"s) {
+            settings.format = serialize::BaseFormat::MAPPED;
+        } else {
+            throw invalid_argument("wrong base format"s);
+        }
+    }
+
+    if (settings_dict.count("prerender_map"s) > 0) {
+        settings.prerender_map = settings_dict.at("prerender_map"s).AsBool();
+    }
+
+    if (settings_dict.count("report"s) > 0) {
+        settings.report = settings_dict.at("report"s).AsBool();
+    }
+
+    return settings;
 }
 
 svg::Color JsonReader::GetColorFromNode(const json::Node& n) const {
@@ -137,6 +419,8 @@ optional<renderer::RenderSettings> JsonReader::GetRenderSettings() const {
 // Оставил наполенние каталога в JsonReader потому что иначе пришлось бы переносить всю логику разбора json запросов
 // в RequestHandler, а он этим по идее не должен заниматься
 void JsonReader::FillCatalogue(TransportCatalogue& catalogue) const {
+    profile::ScopedTimer timer("JsonReader::FillCatalogue"sv);
+
     vector<parsed::Bus> add_bus_deferred;
     vector<parsed::Distances> add_dists_deferred;
 
@@ -179,7 +463,7 @@ void JsonReader::FillCatalogue(TransportCatalogue& catalogue) const {
 void JsonReader::PrintJsonResponse(const RequestHandler& handler, std::ostream& out) const {
     const json::Array& requests = GetStatRequests();
 
-    json::Print(handler.GetJsonResponse(requests), out);
+    handler.PrintJsonResponse(requests, out);
 }
 
 } // transport
\ No newline at end of file
@@ -14,6 +14,8 @@ namespace transport {
 class JsonReader {
 private:
     json::Document json_doc_{json::Node{nullptr}};
+    // Потоковый разбор не оставляет base_requests в документе
+    bool is_base_requests_consumed_ = false;
 
     const json::Array& GetBaseRequests() const;
 
@@ -25,6 +27,8 @@ private:
 
     renderer::RenderSettings DictToRenderSettings(const json::Dict& settings_dict) const;
 
+    route::RouteSettings DictToRouteSettings(const json::Dict& settings_dict) const;
+
     parsed::Bus DictToBus(const json::Dict& bus_dict) const;
 
     std::pair<parsed::Stop, parsed::Distances> DictToStopDists(const json::Dict& stop_dict) const;
@@ -32,6 +36,11 @@ private:
 public:
     JsonReader(std::istream& input);
 
+    // Потоковый разбор: base_requests сразу переносятся в catalogue,
+    // документ строится только для остальных разделов; FillCatalogue
+    // у такого JsonReader бросает std::logic_error
+    JsonReader(std::istream& input, TransportCatalogue& catalogue);
+
     route::RouteSettings GetRouteSettings() const;
 
     serialize::Settings GetSerializeSettings() const;
@@ -42,6 +51,8 @@ public:
 
     bool HasRenderSettings() const; 
 
+    bool HasStatRequests() const;
+
     void FillCatalogue(TransportCatalogue& catalogue) const;
 
     void PrintJsonResponse(const RequestHandler& handler, std::ostream& out) const;
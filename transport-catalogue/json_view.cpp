@@ -0,0 +1,361 @@
+#include <charconv>
+#include <stdexcept>
+
+#include "json_view.h"
+
+using namespace std;
+
+namespace json::view {
+
+namespace {
+
+class Parser {
+public:
+    Parser(const char* begin, const char* end, deque<string>& unescaped_strings)
+        : pos_(begin)
+        , end_(end)
+        , unescaped_strings_(unescaped_strings) {
+    }
+
+    Node ParseDocument() {
+        return ParseValue();
+    }
+
+private:
+    char PeekNonSpace() {
+        while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r'
+                                || *pos_ == '\t' || *pos_ == '\f' || *pos_ == '\v')) {
+            ++pos_;
+        }
+
+        if (pos_ == end_) {
+            throw ParsingError{"unexpected end of input"s};
+        }
+
+        return *pos_;
+    }
+
+    Node ParseValue() {
+        const char c = PeekNonSpace();
+
+        if (c == '[') {
+            ++pos_;
+            return ParseArray();
+        } else if (c == '{') {
+            ++pos_;
+            return ParseDict();
+        } else if (c == '"') {
+            ++pos_;
+            return ParseString();
+        } else {
+            return ParseLexeme();
+        }
+    }
+
+    Node ParseArray() {
+        Array result;
+
+        if (PeekNonSpace() == ']') {
+            ++pos_;
+            return result;
+        }
+
+        while (true) {
+            result.push_back(ParseValue());
+
+            const char c = PeekNonSpace();
+            ++pos_;
+
+            if (c == ']') {
+                break;
+            }
+            if (c != ',') {
+                throw ParsingError{"no closing bracket in array"s};
+            }
+        }
+
+        return result;
+    }
+
+    Node ParseDict() {
+        Dict result;
+
+        if (PeekNonSpace() == '}') {
+            ++pos_;
+            return result;
+        }
+
+        while (true) {
+            if (PeekNonSpace() != '"') {
+                throw ParsingError{"no key in dict"s};
+            }
+            ++pos_;
+            string_view key = ParseString();
+
+            if (PeekNonSpace() != ':') {
+                throw ParsingError{"no colon after key in dict"s};
+            }
+            ++pos_;
+
+            result.emplace_back(key, ParseValue());
+
+            const char c = PeekNonSpace();
+            ++pos_;
+
+            if (c == '}') {
+                break;
+            }
+            if (c != ',') {
+                throw ParsingError{"no closing bracket in dict"s};
+            }
+        }
+
+        return result;
+    }
+
+    // Пока нет escape-последовательностей, строка — это просто кусок буфера
+    string_view ParseString() {
+        const char* begin = pos_;
+
+        while (pos_ != end_ && *pos_ != '"' && *pos_ != '\\') {
+            ++pos_;
+        }
+
+        if (pos_ == end_) {
+            throw ParsingError{"no ending quote in string"s};
+        }
+
+        if (*pos_ == '"') {
+            return {begin, static_cast<size_t>(pos_++ - begin)};
+        }
+
+        string& result = unescaped_strings_.emplace_back(begin, pos_);
+
+        while (true) {
+            if (pos_ == end_) {
+                throw ParsingError{"no ending quote in string"s};
+            }
+
+            const char c = *pos_++;
+
+            if (c == '"') {
+                break;
+            }
+
+            if (c != '\\') {
+                result.push_back(c);
+                continue;
+            }
+
+            if (pos_ == end_) {
+                throw ParsingError{"no ending quote in string"s};
+            }
+
+            switch (*pos_++) {
+                case 'n': result.push_back('\n'); break;
+                case 'r': result.push_back('\r'); break;
+                case 't': result.push_back('\t'); break;
+                case '"': result.push_back('"'); break;
+                case '\\': result.push_back('\\'); break;
+                default: throw ParsingError{"wrong escape sequence"s};
+            }
+        }
+
+        return result;
+    }
+
+    Node ParseLexeme() {
+        const char* begin = pos_;
+
+        while (pos_ != end_ && *pos_ != '}' && *pos_ != ']' && *pos_ != ',' && *pos_ != ' '
+               && *pos_ != '\r' && *pos_ != '\n' && *pos_ != '\t') {
+            ++pos_;
+        }
+
+        const string_view lexeme(begin, pos_ - begin);
+
+        if (lexeme == "null"sv) {
+            return nullptr;
+        } else if (lexeme == "true"sv) {
+            return true;
+        } else if (lexeme == "false"sv) {
+            return false;
+        } else if (lexeme.find_first_of(".eE"sv) != string_view::npos) {
+            return ParseNumber<double>(lexeme);
+        } else {
+            return ParseNumber<int>(lexeme);
+        }
+    }
+
+    template <typename Number>
+    static Number ParseNumber(string_view lexeme) {
+        Number result{};
+        const char* end = lexeme.data() + lexeme.size();
+        const auto [ptr, error] = from_chars(lexeme.data(), end, result);
+
+        if (error != errc{} || ptr != end) {
+            throw ParsingError{"undefined lexeme"s};
+        }
+
+        return result;
+    }
+
+    const char* pos_;
+    const char* end_;
+    deque<string>& unescaped_strings_;
+};
+
+}  // namespace
+
+bool Node::IsNull() const {
+    return holds_alternative<nullptr_t>(*this);
+}
+
+bool Node::IsInt() const {
+    return holds_alternative<int>(*this);
+}
+
+bool Node::IsDouble() const {
+    return holds_alternative<double>(*this) || holds_alternative<int>(*this);
+}
+
+bool Node::IsPureDouble() const {
+    return holds_alternative<double>(*this);
+}
+
+bool Node::IsBool() const {
+    return holds_alternative<bool>(*this);
+}
+
+bool Node::IsArray() const {
+    return holds_alternative<Array>(*this);
+}
+
+bool Node::IsDict() const {
+    return holds_alternative<Dict>(*this);
+}
+
+bool Node::IsString() const {
+    return holds_alternative<string_view>(*this);
+}
+
+const Array& Node::AsArray() const {
+    if (!IsArray()) {
+        throw logic_error("not an array"s);
+    }
+    return get<Array>(*this);
+}
+
+const Dict& Node::AsDict() const {
+    if (!IsDict()) {
+        throw logic_error("not a dict"s);
+    }
+    return get<Dict>(*this);
+}
+
+int Node::AsInt() const {
+    if (!IsInt()) {
+        throw logic_error("not an int"s);
+    }
+    return get<int>(*this);
+}
+
+bool Node::AsBool() const {
+    if (!IsBool()) {
+        throw logic_error("not a bool"s);
+    }
+    return get<bool>(*this);
+}
+
+double Node::AsDouble() const {
+    if (IsInt()) {
+        return double(get<int>(*this));
+    }
+    if (!IsPureDouble()) {
+        throw logic_error("not a double"s);
+    }
+    return get<double>(*this);
+}
+
+string_view Node::AsString() const {
+    if (!IsString()) {
+        throw logic_error("not a string"s);
+    }
+    return get<string_view>(*this);
+}
+
+const Node* Node::Find(string_view key) const {
+    for (const auto& [item_key, value] : AsDict()) {
+        if (item_key == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+const Node& Node::At(string_view key) const {
+    const Node* value = Find(key);
+
+    if (!value) {
+        throw out_of_range("no key "s + string(key));
+    }
+    return *value;
+}
+
+json::Node Node::ToNode() const {
+    if (IsArray()) {
+        json::Array result;
+        result.reserve(AsArray().size());
+
+        for (const Node& item : AsArray()) {
+            result.push_back(item.ToNode());
+        }
+        return result;
+    }
+
+    if (IsDict()) {
+        json::Dict result;
+
+        for (const auto& [key, value] : AsDict()) {
+            result.emplace(string(key), value.ToNode());
+        }
+        return result;
+    }
+
+    if (IsString()) {
+        return string(AsString());
+    }
+    if (IsInt()) {
+        return AsInt();
+    }
+    if (IsPureDouble()) {
+        return AsDouble();
+    }
+    if (IsBool()) {
+        return AsBool();
+    }
+    return nullptr;
+}
+
+Document::Document(vector<char> buffer)
+    : buffer_(move(buffer)) {
+
+    root_ = Parser(buffer_.data(), buffer_.data() + buffer_.size(), unescaped_strings_).ParseDocument();
+}
+
+const Node& Document::GetRoot() const {
+    return root_;
+}
+
+Document Load(istream& input) {
+    vector<char> buffer;
+    char chunk[1 << 16];
+
+    while (input.read(chunk, sizeof(chunk)) || input.gcount() > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + input.gcount());
+    }
+
+    return Document(move(buffer));
+}
+
+}  // namespace json::view
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <deque>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "json.h"
+
+// Разбор JSON без копирования: весь вход читается в один буфер,
+// строки узлов — string_view в этот буфер. Отдельно хранятся только
+// строки с escape-последовательностями, которые приходится раскодировать
+
+namespace json::view {
+
+class Node;
+
+using Array = std::vector<Node>;
+// Ключи в порядке появления во входе; словари в запросах маленькие,
+// поэтому поиск по ключу линейный
+using Dict = std::vector<std::pair<std::string_view, Node>>;
+using JsonValue = std::variant<std::nullptr_t, Array, Dict, bool, int, double, std::string_view>;
+
+class Node final : JsonValue {
+public:
+    using JsonValue::JsonValue;
+
+    const Array& AsArray() const;
+    const Dict& AsDict() const;
+    std::string_view AsString() const;
+    int AsInt() const;
+    double AsDouble() const;
+    bool AsBool() const;
+
+    bool IsInt() const;
+    bool IsDouble() const;
+    bool IsPureDouble() const;
+    bool IsBool() const;
+    bool IsString() const;
+    bool IsNull() const;
+    bool IsArray() const;
+    bool IsDict() const;
+
+    // nullptr, если ключа нет; узел должен быть словарём
+    const Node* Find(std::string_view key) const;
+    // Как Dict::at: при отсутствии ключа бросает std::out_of_range
+    const Node& At(std::string_view key) const;
+
+    // Копия в обычный узел json::Node
+    json::Node ToNode() const;
+};
+
+// Документ владеет буфером, поэтому копировать его нельзя: узлы ссылаются внутрь
+class Document {
+public:
+    explicit Document(std::vector<char> buffer);
+
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+    Document(Document&&) = default;
+    Document& operator=(Document&&) = default;
+
+    const Node& GetRoot() const;
+
+private:
+    std::vector<char> buffer_;
+    // deque не перемещает элементы при добавлении, string_view на них остаются верными
+    std::deque<std::string> unescaped_strings_;
+    Node root_;
+};
+
+// Читает поток целиком и разбирает его
+Document Load(std::istream& input);
+
+}  // namespace json::view
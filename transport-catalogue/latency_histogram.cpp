@@ -0,0 +1,111 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace stats {
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+    const uint64_t value = static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0));
+
+    buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetMax() const {
+    return std::chrono::nanoseconds(max_.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetMean() const {
+    const uint64_t count = GetCount();
+    return std::chrono::nanoseconds(count > 0 ? sum_.load(std::memory_order_relaxed) / count : 0);
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetQuantile(double q) const {
+    const uint64_t count = GetCount();
+
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    // Номер значения квантиля среди отсортированных, считая с единицы
+    const uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(q * count)), 1, count);
+    uint64_t seen = 0;
+
+    for (size_t index = 0; index < BUCKETS_COUNT; ++index) {
+        seen += buckets_[index].load(std::memory_order_relaxed);
+
+        if (seen >= rank) {
+            const uint64_t upper = std::min(GetUpperBound(index), max_.load(std::memory_order_relaxed));
+            return std::chrono::nanoseconds(upper);
+        }
+    }
+
+    // Запись идёт параллельно и счётчик обогнал корзины
+    return GetMax();
+}
+
+std::vector<LatencyHistogram::Bucket> LatencyHistogram::GetBuckets() const {
+    std::vector<Bucket> result;
+
+    for (size_t index = 0; index < BUCKETS_COUNT; ++index) {
+        const uint64_t count = buckets_[index].load(std::memory_order_relaxed);
+
+        if (count > 0) {
+            result.push_back({GetLowerBound(index), GetUpperBound(index), count});
+        }
+    }
+
+    return result;
+}
+
+// Значения меньше SUB_BUCKETS лежат каждое в своей корзине; дальше
+// по 16 корзин на степень двойки, номер внутри — следующие за старшим 4 бита
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+
+    int exponent = 63;
+    while ((value >> exponent) == 0) {
+        --exponent;
+    }
+
+    if (exponent >= MAX_EXPONENT) {
+        return BUCKETS_COUNT - 1;
+    }
+
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t sub_bucket = (value >> shift) - SUB_BUCKETS;
+
+    return static_cast<size_t>(SUB_BUCKETS + shift * SUB_BUCKETS + sub_bucket);
+}
+
+uint64_t LatencyHistogram::GetLowerBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+
+    const size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    const uint64_t sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return (SUB_BUCKETS + sub_bucket) << shift;
+}
+
+uint64_t LatencyHistogram::GetUpperBound(size_t index) {
+    if (index + 1 == BUCKETS_COUNT) {
+        return UINT64_MAX;
+    }
+    return GetLowerBound(index + 1) - 1;
+}
+
+} // namespace stats
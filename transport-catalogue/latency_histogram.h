@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace stats {
+
+// Гистограмма задержек с логарифмическими корзинами: каждая степень двойки
+// делится на 16 равных корзин, поэтому граница квантиля отличается от точного
+// значения не больше чем на 1/16. Запись — несколько атомарных инкрементов
+// без блокировок, так что писать можно из любого числа потоков
+class LatencyHistogram {
+public:
+    struct Bucket {
+        uint64_t lower_ns;
+        uint64_t upper_ns;
+        uint64_t count;
+    };
+
+    void Record(std::chrono::nanoseconds latency);
+
+    uint64_t GetCount() const;
+    std::chrono::nanoseconds GetMax() const;
+    std::chrono::nanoseconds GetMean() const;
+    // Верхняя граница корзины, в которой лежит квантиль q из [0, 1],
+    // но не больше наибольшего записанного значения
+    std::chrono::nanoseconds GetQuantile(double q) const;
+    // Непустые корзины по возрастанию границ
+    std::vector<Bucket> GetBuckets() const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // Значения от 2^40 нс (около 18 минут) попадают в последнюю корзину
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS_COUNT = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetLowerBound(size_t index);
+    static uint64_t GetUpperBound(size_t index);
+
+    std::array<std::atomic<uint64_t>, BUCKETS_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Записывает в histogram время жизни объекта; с nullptr часы не читаются
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* histogram)
+        : histogram_(histogram) {
+
+        if (histogram_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedLatency() {
+        if (histogram_) {
+            histogram_->Record(std::chrono::steady_clock::now() - start_);
+        }
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace stats
@@ -1,16 +1,92 @@
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <string_view>
 
 #include "json_reader.h"
+#include "profile.h"
 #include "transport_router.h"
 
 using namespace std::literals;
 using namespace std;
 
 void PrintUsage(std::ostream& stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|process_requests|serve] [--profile[=file]] [--latency[=file]]\n"sv;
+    stream << "  --profile  print per-phase timings and counters as JSON to stderr or to file\n"sv;
+    stream << "  --latency  print per-request-type latency percentiles as a table to stderr\n"sv;
+    stream << "             or as JSON with histogram buckets to file\n"sv;
+}
+
+// Пустая строка — вывод в cerr
+using ReportFile = std::optional<std::string>;
+
+// Сводка задержек по типам запросов: таблицей в cerr или JSON с корзинами в файл
+void WriteLatencyReport(const transport::RequestHandler& handler, const std::string& file) {
+    if (file.empty()) {
+        handler.PrintLatencySummary(cerr);
+        return;
+    }
+
+    ofstream report(file);
+    json::Writer writer(report);
+    handler.WriteLatencyStats(writer, true);
+    report << '\n';
+}
+
+// Режим сервера: база загружается один раз, дальше каждая непустая строка входа —
+// отдельный JSON-документ со stat_requests (NDJSON). Первая строка, кроме того,
+// содержит serialization_settings. На каждую строку печатается массив ответов
+// в формате process_requests и перевод строки, после чего вывод сбрасывается.
+// Ошибка в строке не останавливает сервер: вместо массива печатается
+// словарь с error_message
+int Serve(std::istream& input, std::ostream& output, const ReportFile& latency_file) {
+    using namespace transport;
+
+    TransportCatalogue catalogue;
+    RequestHandler handler(catalogue);
+    handler.SetLatencyStats(latency_file.has_value());
+    bool is_loaded = false;
+
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.find_first_not_of(" \t\r"sv) == std::string::npos) {
+            continue;
+        }
+
+        // Ответ собирается целиком, чтобы ошибка посреди пакета
+        // не оставила в выводе половину массива
+        std::ostringstream response;
+
+        try {
+            std::istringstream line_input(line);
+            JsonReader reader(line_input);
+
+            if (!is_loaded) {
+                handler.Deserialize(reader.GetSerializeSettings());
+                is_loaded = true;
+            }
+
+            if (reader.HasStatRequests()) {
+                reader.PrintJsonResponse(handler, response);
+            } else {
+                json::Writer(response).StartArray().EndArray();
+            }
+        } catch (const std::exception& e) {
+            response.str(""s);
+            json::Writer(response).StartDict().Key("error_message"sv).Value(e.what()).EndDict();
+        }
+
+        output << response.str() << std::endl;
+    }
+
+    if (latency_file) {
+        WriteLatencyReport(handler, *latency_file);
+    }
+
+    return 0;
 }
 
 // int prev_main() {
@@ -31,22 +107,15 @@ void PrintUsage(std::ostream& stream = std::cerr) {
 //     return 0;
 // }
 
-int main(int argc, char* argv[]) {
+int Run(std::string_view mode, const ReportFile& latency_file) {
     using namespace transport;
     using namespace route;
 
-    if (argc != 2) {
-        PrintUsage();
-        return 1;
-    }
-
+    profile::ScopedTimer timer(mode);
     TransportCatalogue catalogue;
 
-    const std::string_view mode(argv[1]);
-
     if (mode == "make_base"sv) {
-        JsonReader reader(cin);
-        reader.FillCatalogue(catalogue);
+        JsonReader reader(cin, catalogue);
         RequestHandler handler(catalogue);
 
         handler.Serialize(reader.GetSerializeSettings(), reader.GetRenderSettings(), reader.GetRouteSettingsOpt());
@@ -55,18 +124,82 @@ int main(int argc, char* argv[]) {
         JsonReader reader(cin);
         RequestHandler handler(catalogue);
 
+        handler.SetLatencyStats(latency_file.has_value());
         handler.Deserialize(reader.GetSerializeSettings());
 
         reader.PrintJsonResponse(handler, cout);
 
+        if (latency_file) {
+            WriteLatencyReport(handler, *latency_file);
+        }
+
         // ofstream svg("out.svg");
 
         // handler.RenderMap().Render(svg);
 
+    } else if (mode == "serve"sv) {
+        return Serve(cin, cout, latency_file);
     } else {
         PrintUsage();
         return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+// Разбирает --name и --name=file; false, если option — другой ключ
+bool ParseReportOption(std::string_view option, std::string_view name, ReportFile& file) {
+    if (option.substr(0, name.size()) != name) {
+        return false;
+    }
+
+    option.remove_prefix(name.size());
+
+    if (option.empty()) {
+        file = ""s;
+    } else if (option.front() == '=') {
+        file = std::string(option.substr(1));
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        PrintUsage();
+        return 1;
+    }
+
+    // Отчёты пишутся в файл после --profile= и --latency= или в cerr
+    ReportFile profile_file;
+    ReportFile latency_file;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view option(argv[i]);
+
+        if (!ParseReportOption(option, "--profile"sv, profile_file)
+            && !ParseReportOption(option, "--latency"sv, latency_file)) {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (profile_file) {
+        profile::Enable();
+    }
+
+    const int result = Run(argv[1], latency_file);
+
+    if (profile_file) {
+        if (profile_file->empty()) {
+            profile::WriteReport(cerr);
+        } else {
+            ofstream report(*profile_file);
+            profile::WriteReport(report);
+        }
+    }
+
+    return result;
+}
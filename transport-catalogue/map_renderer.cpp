@@ -137,6 +137,31 @@ void StopLabels::Draw(svg::ObjectContainer& container) const {
     }
 }
 
+IsochroneStops::IsochroneStops(const std::vector<std::pair<const Stop*, double>>& stops,
+        const SphereProjector& proj,
+        double radius,
+        double max_time)
+
+        : stops_(stops), proj_(proj), radius_(radius), max_time_(max_time) {
+
+}
+
+void IsochroneStops::Draw(svg::ObjectContainer& container) const {
+    // Позже достигнутые остановки рисуются раньше, чтобы ближние были сверху
+    for (auto it = stops_.rbegin(); it != stops_.rend(); ++it) {
+        const auto [stop, time] = *it;
+        const double share = max_time_ > 0 ? clamp(time / max_time_, 0., 1.) : 0.;
+
+        svg::Circle sym;
+
+        sym.SetCenter(proj_(stop->coordinates))
+           .SetRadius(radius_)
+           .SetFillColor(svg::Rgba(static_cast<uint8_t>(255 * share), static_cast<uint8_t>(255 * (1 - share)), 0, 0.6));
+
+        container.Add(sym);
+    }
+}
+
 } // map_objects
 
 MapRenderer::MapRenderer(SphereProjector proj, 
@@ -219,6 +244,33 @@ const svg::Document& MapRenderer::GetSvgDoc() const {
     return svg_doc_;
 }
 
+const svg::Document& MapRenderer::RenderSvgDoc() {
+    if (!is_rendered_) {
+        AddLinesToSvg();
+        AddBusLabelsToSvg();
+        AddStopSymToSvg();
+        AddStopLabelsToSvg();
+        is_rendered_ = true;
+    }
+
+    return svg_doc_;
+}
+
+svg::Document MapRenderer::RenderIsochrone(const vector<pair<const Stop*, double>>& stops,
+        double max_time) const {
+    svg::Document doc;
+
+    map_objects::IsochroneStops syms{
+        stops,
+        proj_,
+        settings_.stop_radius * 2,
+        max_time};
+
+    syms.Draw(doc);
+
+    return doc;
+}
+
 } // renderer
 
 } // transport
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <optional>
+#include <utility>
 
 inline const double EPSILON = 1e-6;
 inline bool IsZero(double value) {
@@ -109,6 +110,7 @@ private:
     std::vector<const Stop*> stops_;
     svg::Document svg_doc_;
     int color_index_ = 0;
+    bool is_rendered_ = false;
 
 public:
     MapRenderer(SphereProjector proj, 
@@ -122,6 +124,14 @@ public:
     void AddStopLabelsToSvg();
 
     const svg::Document& GetSvgDoc() const;
+
+    // Заполняет документ всеми слоями карты; повторный вызов ничего не добавляет
+    const svg::Document& RenderSvgDoc();
+
+    // Отдельный слой в проекции карты: кружок вокруг каждой достигнутой остановки,
+    // цвет от зелёного (время 0) до красного (время max_time)
+    svg::Document RenderIsochrone(const std::vector<std::pair<const Stop*, double>>& stops,
+        double max_time) const;
 };
 
 namespace map_objects {
@@ -172,6 +182,22 @@ private:
     double stop_radius_;
 };
 
+class IsochroneStops : public svg::Drawable {
+public:
+    IsochroneStops(const std::vector<std::pair<const Stop*, double>>& stops,
+        const SphereProjector& proj,
+        double radius,
+        double max_time);
+
+    void Draw(svg::ObjectContainer& container) const override;
+
+private:
+    const std::vector<std::pair<const Stop*, double>>& stops_;
+    const SphereProjector& proj_;
+    double radius_;
+    double max_time_;
+};
+
 class StopLabels : public svg::Drawable {
 public:
     StopLabels(const std::vector<const Stop*>& stops,
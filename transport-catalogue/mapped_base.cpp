@@ -0,0 +1,811 @@
+#include "mapped_base.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRANSPORT_CATALOGUE_HAS_MMAP
+#endif
+
+#include "profile.h"
+#include "serialization.h"
+
+using namespace std::literals;
+
+namespace serialize {
+
+namespace mapped {
+
+Graph::Graph(const Edge* edges, size_t edge_count, const uint32_t* incidence_offsets,
+    const uint32_t* incidence_edges, size_t vertex_count, const std::string_view* bus_names)
+    : edges_(edges)
+    , edge_count_(edge_count)
+    , incidence_offsets_(incidence_offsets)
+    , incidence_edges_(incidence_edges)
+    , vertex_count_(vertex_count)
+    , bus_names_(bus_names) {
+}
+
+size_t Graph::GetVertexCount() const {
+    return vertex_count_;
+}
+
+size_t Graph::GetEdgeCount() const {
+    return edge_count_;
+}
+
+graph::Edge<route::RouteWeight> Graph::GetEdge(graph::EdgeId edge_id) const {
+    const Edge& edge = edges_[edge_id];
+
+    return {edge.from, edge.to, route::RouteWeight{bus_names_[edge.bus], edge.total_time, edge.span_count}};
+}
+
+Graph::IncidentEdgesRange Graph::GetIncidentEdges(graph::VertexId vertex) const {
+    return {incidence_edges_ + incidence_offsets_[vertex], incidence_edges_ + incidence_offsets_[vertex + 1]};
+}
+
+FileImage::FileImage(const std::filesystem::path& file) {
+#ifdef TRANSPORT_CATALOGUE_HAS_MMAP
+    const int fd = ::open(file.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw std::runtime_error("can't open base file "s + file.string());
+    }
+
+    struct stat file_stat;
+
+    if (::fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        throw std::runtime_error("wrong base file "s + file.string());
+    }
+
+    const auto size = static_cast<size_t>(file_stat.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("can't map base file "s + file.string());
+    }
+
+    data_ = static_cast<const char*>(data);
+    size_ = size;
+#else
+    std::ifstream in_file(file, std::ios::binary);
+
+    if (!in_file.is_open()) {
+        throw std::runtime_error("can't open base file "s + file.string());
+    }
+
+    buffer_.assign(std::istreambuf_iterator<char>(in_file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+FileImage::~FileImage() {
+#ifdef TRANSPORT_CATALOGUE_HAS_MMAP
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+const char* FileImage::GetData() const {
+    return data_;
+}
+
+size_t FileImage::GetSize() const {
+    return size_;
+}
+
+} // mapped
+
+namespace {
+
+// Собирает образ файла в памяти: заголовок, затем секции, выровненные на 8 байт
+class ImageWriter {
+public:
+    ImageWriter() : image_(sizeof(mapped::Header), '\0') {
+    }
+
+    template <typename T>
+    mapped::Section Add(const std::vector<T>& items) {
+        return AddBytes(items.data(), items.size() * sizeof(T));
+    }
+
+    mapped::Section AddBytes(const void* data, size_t size) {
+        image_.resize((image_.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, '\0');
+
+        mapped::Section section{image_.size(), size};
+        image_.append(static_cast<const char*>(data), size);
+
+        return section;
+    }
+
+    bool Write(const std::filesystem::path& file, const mapped::Header& header) {
+        std::memcpy(image_.data(), &header, sizeof(header));
+
+        std::ofstream out_file(file, std::ios::binary);
+
+        if (!out_file.is_open()) {
+            return false;
+        }
+
+        out_file.write(image_.data(), image_.size());
+
+        return static_cast<bool>(out_file);
+    }
+
+private:
+    static constexpr size_t ALIGNMENT = 8;
+
+    std::string image_;
+};
+
+} // namespace
+
+bool MappedBase::Save(const std::filesystem::path& file,
+    const transport::TransportCatalogue& catalogue,
+    const std::optional<transport::renderer::RenderSettings>& render_settings,
+    const route::TransportRouter* router,
+    const transport::StopIndex& stop_index,
+    std::string_view map_svg) {
+
+    profile::ScopedTimer timer("MappedBase::Save"sv);
+
+    ImageWriter writer;
+    mapped::Header header;
+    std::memcpy(header.magic, mapped::MAGIC, sizeof(header.magic));
+
+    std::string strings;
+    auto add_string = [&strings](std::string_view str) {
+        const auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(str);
+        return offset;
+    };
+
+    std::vector<const transport::Stop*> stops_by_id;
+    stops_by_id.reserve(catalogue.GetStopsSize());
+    for (const auto& stop : catalogue.GetStops()) {
+        stops_by_id.push_back(&stop);
+    }
+
+    // Автобусы лежат в порядке справочника, чтобы граф, построенный заново
+    // по образу, совпадал с графом исходного справочника вплоть до порядка рёбер
+    std::vector<mapped::Bus> buses;
+    std::vector<uint32_t> bus_stops;
+    std::unordered_map<std::string_view, uint32_t> bus_index_by_name;
+
+    for (const transport::Bus& bus_item : catalogue.GetBuses()) {
+        const transport::Bus* bus = &bus_item;
+        const transport::BusStat& stat = catalogue.GetBusStatById(bus->id);
+
+        mapped::Bus mapped_bus;
+        mapped_bus.name_offset = add_string(bus->name);
+        mapped_bus.name_size = static_cast<uint32_t>(bus->name.size());
+        mapped_bus.stops_begin = static_cast<uint32_t>(bus_stops.size());
+        mapped_bus.stops_count = static_cast<uint32_t>(bus->bus_stops.size());
+        mapped_bus.circular = bus->circular;
+        mapped_bus.all_stops = stat.all_stops;
+        mapped_bus.unique_stops = stat.unique_stops;
+        mapped_bus.length = stat.length;
+        mapped_bus.curvature = stat.curvature;
+
+        for (const auto* stop : bus->bus_stops) {
+            bus_stops.push_back(stop->id);
+        }
+
+        bus_index_by_name[bus->name] = static_cast<uint32_t>(buses.size());
+        buses.push_back(mapped_bus);
+    }
+
+    // Номера автобусов у остановки идут в порядке названий, как в ответах на запросы Stop
+    std::vector<uint32_t> buses_by_name;
+    buses_by_name.reserve(buses.size());
+    for (std::string_view name : *catalogue.GetBusNames()) {
+        buses_by_name.push_back(bus_index_by_name.at(name));
+    }
+
+    std::vector<mapped::Stop> stops;
+    std::vector<uint32_t> stop_buses;
+
+    for (const auto* stop : stops_by_id) {
+        mapped::Stop mapped_stop;
+        mapped_stop.lat = stop->coordinates.lat;
+        mapped_stop.lng = stop->coordinates.lng;
+        mapped_stop.name_offset = add_string(stop->name);
+        mapped_stop.name_size = static_cast<uint32_t>(stop->name.size());
+        mapped_stop.buses_begin = static_cast<uint32_t>(stop_buses.size());
+        mapped_stop.buses_count = static_cast<uint32_t>(stop->buses_through.size());
+
+        for (std::string_view bus_name : stop->buses_through) {
+            stop_buses.push_back(bus_index_by_name.at(bus_name));
+        }
+
+        stops.push_back(mapped_stop);
+    }
+
+    std::vector<uint32_t> stops_by_name(stops_by_id.size());
+    for (uint32_t id = 0; id < stops_by_name.size(); ++id) {
+        stops_by_name[id] = id;
+    }
+    std::sort(stops_by_name.begin(), stops_by_name.end(), [&stops_by_id](uint32_t lhs, uint32_t rhs) {
+        return stops_by_id[lhs]->name < stops_by_id[rhs]->name;
+    });
+
+    std::vector<mapped::Distance> distances;
+    for (const auto& [from_to, length] : catalogue.GetDistances()) {
+        distances.push_back({from_to.first, from_to.second, length});
+    }
+    std::sort(distances.begin(), distances.end(), [](const mapped::Distance& lhs, const mapped::Distance& rhs) {
+        return std::pair{lhs.from, lhs.to} < std::pair{rhs.from, rhs.to};
+    });
+
+    header.strings = writer.AddBytes(strings.data(), strings.size());
+    header.stops = writer.Add(stops);
+    header.stops_by_name = writer.Add(stops_by_name);
+    header.stop_buses = writer.Add(stop_buses);
+    header.buses = writer.Add(buses);
+    header.buses_by_name = writer.Add(buses_by_name);
+    header.bus_stops = writer.Add(bus_stops);
+    header.distances = writer.Add(distances);
+
+    const auto cell_offsets = stop_index.GetCellOffsets();
+    const auto index_entries = stop_index.GetEntries();
+    header.stop_index_grid = writer.AddBytes(&stop_index.GetGrid(), sizeof(transport::StopIndex::Grid));
+    header.stop_index_offsets = writer.AddBytes(cell_offsets.begin(),
+        (cell_offsets.end() - cell_offsets.begin()) * sizeof(uint32_t));
+    header.stop_index_entries = writer.AddBytes(index_entries.begin(),
+        (index_entries.end() - index_entries.begin()) * sizeof(transport::StopIndex::Entry));
+
+    if (render_settings) {
+        const std::string proto_settings =
+            Serializator::MakeProtoRenderSettings(*render_settings).SerializeAsString();
+        header.render_settings = writer.AddBytes(proto_settings.data(), proto_settings.size());
+    }
+
+    if (router) {
+        const auto& settings = router->GetSettings();
+        const auto& graph = router->GetGraph();
+
+        mapped::RouteSettings route_settings;
+        route_settings.bus_wait_time = settings.bus_wait_time;
+        route_settings.bus_velocity = settings.bus_velocity;
+        route_settings.mode = static_cast<uint32_t>(settings.mode);
+        route_settings.graph_model = static_cast<uint32_t>(settings.graph_model);
+        route_settings.vertex_count = static_cast<uint32_t>(graph.GetVertexCount());
+        route_settings.has_graph = router->IsGraphInitialized();
+        route_settings.walk_velocity = settings.walk_velocity;
+        route_settings.max_walk_distance = settings.max_walk_distance;
+
+        header.has_route_settings = 1;
+        header.route_settings = writer.AddBytes(&route_settings, sizeof(route_settings));
+
+        if (router->IsGraphInitialized()) {
+            std::vector<mapped::Edge> edges;
+            edges.reserve(graph.GetEdgeCount());
+
+            for (const auto& edge : graph.GetEdges()) {
+                edges.push_back({static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to),
+                    bus_index_by_name.at(edge.weight.bus_name), edge.weight.span_count, edge.weight.total_time});
+            }
+
+            std::vector<uint32_t> incidence_offsets{0};
+            std::vector<uint32_t> incidence_edges;
+            incidence_edges.reserve(graph.GetEdgeCount());
+
+            for (const auto& list : graph.GetIncidenceLists()) {
+                incidence_edges.insert(incidence_edges.end(), list.begin(), list.end());
+                incidence_offsets.push_back(static_cast<uint32_t>(incidence_edges.size()));
+            }
+
+            const auto& vertex_stop_ids = router->GetVertexStopIds();
+
+            header.edges = writer.Add(edges);
+            header.incidence_offsets = writer.Add(incidence_offsets);
+            header.incidence_edges = writer.Add(incidence_edges);
+            header.vertex_stop_ids = writer.AddBytes(vertex_stop_ids.data(), vertex_stop_ids.size() * sizeof(int));
+        }
+
+        if (router->IsInitialized() && router->GetRouter()) {
+            header.routes_matrix = writer.Add(router->GetRouter()->GetRoutesInternalData());
+        }
+    }
+
+    header.map_svg = writer.AddBytes(map_svg.data(), map_svg.size());
+
+    return writer.Write(file, header);
+}
+
+MappedBase::MappedBase(const std::filesystem::path& file)
+    : image_(file)
+    , data_(image_.GetData())
+    , size_(image_.GetSize()) {
+
+    profile::ScopedTimer timer("MappedBase::Open"sv);
+
+    header_ = reinterpret_cast<const mapped::Header*>(data_);
+
+    if (!IsValid()) {
+        throw std::runtime_error("wrong base file "s + file.string());
+    }
+
+    stop_index_ = transport::StopIndex(*GetArray<transport::StopIndex::Grid>(header_->stop_index_grid),
+        GetArray<uint32_t>(header_->stop_index_offsets),
+        GetArray<transport::StopIndex::Entry>(header_->stop_index_entries));
+
+    const auto* buses = GetArray<mapped::Bus>(header_->buses);
+    const size_t buses_count = GetCount<mapped::Bus>(header_->buses);
+
+    bus_names_.reserve(buses_count);
+    for (size_t i = 0; i < buses_count; ++i) {
+        bus_names_.push_back(GetString(buses[i].name_offset, buses[i].name_size));
+    }
+
+    if (HasGraph()) {
+        graph_ = std::make_unique<mapped::Graph>(
+            GetArray<mapped::Edge>(header_->edges), GetCount<mapped::Edge>(header_->edges),
+            GetArray<uint32_t>(header_->incidence_offsets), GetArray<uint32_t>(header_->incidence_edges),
+            GetCount<uint32_t>(header_->incidence_offsets) - 1, bus_names_.data());
+    }
+}
+
+namespace {
+
+// Секция — целое число элементов типа T
+template <typename T>
+bool HasWholeItems(const mapped::Section& section) {
+    return section.size % sizeof(T) == 0;
+}
+
+// Смещения CSR: offsets_count = items + 1, не убывают, последнее равно числу элементов
+bool AreOffsetsValid(const uint32_t* offsets, size_t offsets_count, size_t items_count) {
+    return offsets_count > 0
+        && offsets[0] == 0
+        && std::is_sorted(offsets, offsets + offsets_count)
+        && offsets[offsets_count - 1] == items_count;
+}
+
+// Диапазон [begin, begin + count) внутри массива из size элементов
+bool IsRangeValid(uint64_t begin, uint64_t count, uint64_t size) {
+    return begin <= size && count <= size - begin;
+}
+
+} // namespace
+
+bool MappedBase::IsValid() const {
+    if (size_ < sizeof(mapped::Header)
+        || std::memcmp(header_->magic, mapped::MAGIC, sizeof(mapped::MAGIC)) != 0
+        || header_->version != mapped::VERSION) {
+        return false;
+    }
+
+    // Все секции внутри файла и выровнены так же, как их пишет ImageWriter
+    const mapped::Section* sections_begin = &header_->strings;
+    const mapped::Section* sections_end = &header_->map_svg + 1;
+
+    const bool are_sections_valid = std::all_of(sections_begin, sections_end, [this](const mapped::Section& section) {
+        return IsRangeValid(section.offset, section.size, size_) && section.offset % alignof(double) == 0;
+    });
+
+    if (!are_sections_valid
+        || !HasWholeItems<mapped::Stop>(header_->stops)
+        || !HasWholeItems<uint32_t>(header_->stops_by_name)
+        || !HasWholeItems<uint32_t>(header_->stop_buses)
+        || !HasWholeItems<mapped::Bus>(header_->buses)
+        || !HasWholeItems<uint32_t>(header_->buses_by_name)
+        || !HasWholeItems<uint32_t>(header_->bus_stops)
+        || !HasWholeItems<mapped::Distance>(header_->distances)
+        || !HasWholeItems<uint32_t>(header_->stop_index_offsets)
+        || !HasWholeItems<transport::StopIndex::Entry>(header_->stop_index_entries)) {
+        return false;
+    }
+
+    const auto* stops = GetArray<mapped::Stop>(header_->stops);
+    const size_t stops_count = GetCount<mapped::Stop>(header_->stops);
+    const auto* buses = GetArray<mapped::Bus>(header_->buses);
+    const size_t buses_count = GetCount<mapped::Bus>(header_->buses);
+    const size_t stop_buses_count = GetCount<uint32_t>(header_->stop_buses);
+    const size_t bus_stops_count = GetCount<uint32_t>(header_->bus_stops);
+    const uint64_t strings_size = header_->strings.size;
+
+    auto is_stop_id = [stops_count](uint32_t id) {
+        return id < stops_count;
+    };
+    auto is_bus_id = [buses_count](uint32_t id) {
+        return id < buses_count;
+    };
+
+    const bool are_stops_valid = std::all_of(stops, stops + stops_count, [&](const mapped::Stop& stop) {
+        return IsRangeValid(stop.name_offset, stop.name_size, strings_size)
+            && IsRangeValid(stop.buses_begin, stop.buses_count, stop_buses_count);
+    });
+
+    const bool are_buses_valid = std::all_of(buses, buses + buses_count, [&](const mapped::Bus& bus) {
+        return IsRangeValid(bus.name_offset, bus.name_size, strings_size)
+            && IsRangeValid(bus.stops_begin, bus.stops_count, bus_stops_count);
+    });
+
+    const auto* stops_by_name = GetArray<uint32_t>(header_->stops_by_name);
+    const auto* buses_by_name = GetArray<uint32_t>(header_->buses_by_name);
+    const auto* stop_buses = GetArray<uint32_t>(header_->stop_buses);
+    const auto* bus_stops = GetArray<uint32_t>(header_->bus_stops);
+    const auto* distances = GetArray<mapped::Distance>(header_->distances);
+    const size_t distances_count = GetCount<mapped::Distance>(header_->distances);
+
+    if (!are_stops_valid || !are_buses_valid
+        || GetCount<uint32_t>(header_->stops_by_name) != stops_count
+        || !std::all_of(stops_by_name, stops_by_name + stops_count, is_stop_id)
+        || GetCount<uint32_t>(header_->buses_by_name) != buses_count
+        || !std::all_of(buses_by_name, buses_by_name + buses_count, is_bus_id)
+        || !std::all_of(stop_buses, stop_buses + stop_buses_count, is_bus_id)
+        || !std::all_of(bus_stops, bus_stops + bus_stops_count, is_stop_id)
+        || !std::all_of(distances, distances + distances_count, [&](const mapped::Distance& distance) {
+               return is_stop_id(distance.from) && is_stop_id(distance.to);
+           })) {
+        return false;
+    }
+
+    if (header_->stop_index_grid.size != sizeof(transport::StopIndex::Grid)) {
+        return false;
+    }
+
+    const auto& grid = *GetArray<transport::StopIndex::Grid>(header_->stop_index_grid);
+    const auto* index_entries = GetArray<transport::StopIndex::Entry>(header_->stop_index_entries);
+    const size_t index_entries_count = GetCount<transport::StopIndex::Entry>(header_->stop_index_entries);
+    const size_t cells_count = static_cast<size_t>(grid.rows) * grid.cols;
+
+    if (GetCount<uint32_t>(header_->stop_index_offsets) != cells_count + 1
+        || !AreOffsetsValid(GetArray<uint32_t>(header_->stop_index_offsets), cells_count + 1, index_entries_count)
+        || !std::all_of(index_entries, index_entries + index_entries_count,
+               [&](const transport::StopIndex::Entry& entry) {
+                   return is_stop_id(entry.stop_id);
+               })) {
+        return false;
+    }
+
+    if (header_->has_route_settings && header_->route_settings.size < sizeof(mapped::RouteSettings)) {
+        return false;
+    }
+
+    if (HasGraph()) {
+        return IsGraphValid();
+    }
+
+    // Без графа матрице маршрутов не на что ссылаться
+    return header_->routes_matrix.size == 0;
+}
+
+bool MappedBase::IsGraphValid() const {
+    using Router = route::TransportRouter::Router;
+
+    const auto& settings = *GetArray<mapped::RouteSettings>(header_->route_settings);
+    const size_t vertex_count = settings.vertex_count;
+    const size_t stops_count = GetCount<mapped::Stop>(header_->stops);
+    const size_t buses_count = GetCount<mapped::Bus>(header_->buses);
+
+    if (!HasWholeItems<mapped::Edge>(header_->edges)
+        || !HasWholeItems<uint32_t>(header_->incidence_offsets)
+        || !HasWholeItems<uint32_t>(header_->incidence_edges)
+        || !HasWholeItems<int>(header_->vertex_stop_ids)
+        // Первые вершины графа — остановки, их номера совпадают
+        || vertex_count < stops_count
+        || GetCount<uint32_t>(header_->incidence_offsets) != vertex_count + 1
+        || GetCount<int>(header_->vertex_stop_ids) != vertex_count) {
+        return false;
+    }
+
+    const auto* edges = GetArray<mapped::Edge>(header_->edges);
+    const size_t edges_count = GetCount<mapped::Edge>(header_->edges);
+    const auto* incidence_edges = GetArray<uint32_t>(header_->incidence_edges);
+    const size_t incidence_edges_count = GetCount<uint32_t>(header_->incidence_edges);
+    const auto* vertex_stop_ids = GetArray<int>(header_->vertex_stop_ids);
+
+    const bool is_valid = AreOffsetsValid(GetArray<uint32_t>(header_->incidence_offsets),
+            vertex_count + 1, incidence_edges_count)
+        && std::all_of(edges, edges + edges_count, [&](const mapped::Edge& edge) {
+               return edge.from < vertex_count && edge.to < vertex_count && edge.bus < buses_count;
+           })
+        && std::all_of(incidence_edges, incidence_edges + incidence_edges_count, [edges_count](uint32_t edge_id) {
+               return edge_id < edges_count;
+           })
+        && std::all_of(vertex_stop_ids, vertex_stop_ids + vertex_count, [stops_count](int stop_id) {
+               return stop_id >= 0 && static_cast<size_t>(stop_id) < stops_count;
+           });
+
+    // Матрица ALL_PAIRS либо не сохранена, либо ровно V×V;
+    // номера рёбер в ней проверяются при обходе, чтобы не читать её целиком
+    return is_valid
+        && (header_->routes_matrix.size == 0
+            || header_->routes_matrix.size == vertex_count * vertex_count * sizeof(Router::RouteInternalData));
+}
+
+template <typename T>
+const T* MappedBase::GetArray(const mapped::Section& section) const {
+    return reinterpret_cast<const T*>(data_ + section.offset);
+}
+
+template <typename T>
+size_t MappedBase::GetCount(const mapped::Section& section) const {
+    return section.size / sizeof(T);
+}
+
+std::string_view MappedBase::GetString(uint32_t offset, uint32_t size) const {
+    return {data_ + header_->strings.offset + offset, size};
+}
+
+std::optional<uint32_t> MappedBase::FindStop(std::string_view name) const {
+    const auto* stops = GetArray<mapped::Stop>(header_->stops);
+    const auto* begin = GetArray<uint32_t>(header_->stops_by_name);
+    const auto* end = begin + GetCount<uint32_t>(header_->stops_by_name);
+
+    const auto* it = std::lower_bound(begin, end, name, [this, stops](uint32_t id, std::string_view value) {
+        return GetString(stops[id].name_offset, stops[id].name_size) < value;
+    });
+
+    if (it == end || GetString(stops[*it].name_offset, stops[*it].name_size) != name) {
+        return std::nullopt;
+    }
+
+    return *it;
+}
+
+const mapped::Bus* MappedBase::FindBus(std::string_view name) const {
+    const auto* buses = GetArray<mapped::Bus>(header_->buses);
+    const auto* begin = GetArray<uint32_t>(header_->buses_by_name);
+    const auto* end = begin + GetCount<uint32_t>(header_->buses_by_name);
+
+    const auto* it = std::lower_bound(begin, end, name, [this, buses](uint32_t id, std::string_view value) {
+        return GetString(buses[id].name_offset, buses[id].name_size) < value;
+    });
+
+    if (it == end || GetString(buses[*it].name_offset, buses[*it].name_size) != name) {
+        return nullptr;
+    }
+
+    return &buses[*it];
+}
+
+std::optional<transport::BusStat> MappedBase::GetBusStat(std::string_view name) const {
+    const mapped::Bus* bus = FindBus(name);
+
+    if (!bus) {
+        return std::nullopt;
+    }
+
+    return transport::BusStat{bus->all_stops, bus->unique_stops, bus->length, bus->curvature};
+}
+
+const transport::StopIndex& MappedBase::GetStopIndex() const {
+    return stop_index_;
+}
+
+std::string_view MappedBase::GetStopName(transport::StopId id) const {
+    const mapped::Stop& stop = GetArray<mapped::Stop>(header_->stops)[id];
+    return GetString(stop.name_offset, stop.name_size);
+}
+
+std::optional<std::vector<std::string_view>> MappedBase::GetBusesThroughStop(std::string_view name) const {
+    const auto stop_id = FindStop(name);
+
+    if (!stop_id) {
+        return std::nullopt;
+    }
+
+    const mapped::Stop& stop = GetArray<mapped::Stop>(header_->stops)[*stop_id];
+    const auto* stop_buses = GetArray<uint32_t>(header_->stop_buses) + stop.buses_begin;
+
+    std::vector<std::string_view> result;
+    result.reserve(stop.buses_count);
+
+    for (uint32_t i = 0; i < stop.buses_count; ++i) {
+        result.push_back(bus_names_[stop_buses[i]]);
+    }
+
+    return result;
+}
+
+bool MappedBase::HasGraph() const {
+    return header_->has_route_settings
+        && GetArray<mapped::RouteSettings>(header_->route_settings)->has_graph;
+}
+
+const MappedBase::DijkstraRouter& MappedBase::GetDijkstraRouter() const {
+    std::call_once(dijkstra_router_once_, [this] {
+        dijkstra_router_ = std::make_unique<DijkstraRouter>(*graph_);
+    });
+
+    return *dijkstra_router_;
+}
+
+MappedBase::TransportRoute MappedBase::MakeRides(const std::vector<graph::EdgeId>& edges) const {
+    return route::MakeTransportRoute(*graph_, GetArray<int>(header_->vertex_stop_ids),
+        GetCount<mapped::Stop>(header_->stops), edges, [this](transport::StopId id) {
+            return GetStopName(id);
+        });
+}
+
+std::optional<std::vector<graph::EdgeId>>
+MappedBase::FindRouteEdges(graph::VertexId from, graph::VertexId to) const {
+    using Router = route::TransportRouter::Router;
+
+    if (header_->routes_matrix.size == 0) {
+        auto route = GetDijkstraRouter().BuildRoute(from, to);
+
+        if (!route) {
+            return std::nullopt;
+        }
+        return std::move(route->edges);
+    }
+
+    // Матрица ALL_PAIRS лежит в файле в том же виде, что и в памяти graph::Router
+    const auto* cells = GetArray<Router::RouteInternalData>(header_->routes_matrix);
+    const size_t vertex_count = graph_->GetVertexCount();
+
+    if (cells[from * vertex_count + to].weight == Router::UNREACHABLE) {
+        return std::nullopt;
+    }
+
+    std::vector<graph::EdgeId> edges;
+    for (uint32_t edge_id = cells[from * vertex_count + to].prev_edge;
+         edge_id != Router::NO_EDGE;
+         edge_id = cells[from * vertex_count + graph_->GetEdge(edge_id).from].prev_edge)
+    {
+        // Путь длиннее числа вершин или чужое ребро — испорченная матрица
+        if (edge_id >= graph_->GetEdgeCount() || edges.size() >= vertex_count) {
+            throw std::runtime_error("wrong routes matrix in base file"s);
+        }
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return edges;
+}
+
+std::optional<MappedBase::TransportRoute> MappedBase::BuildRoute(std::string_view from, std::string_view to) const {
+    const auto from_id = FindStop(from);
+    const auto to_id = FindStop(to);
+
+    if (!from_id || !to_id) {
+        return std::nullopt;
+    }
+
+    if (*from_id == *to_id) {
+        return TransportRoute{};
+    }
+
+    auto route_edges = FindRouteEdges(*from_id, *to_id);
+
+    if (!route_edges) {
+        return std::nullopt;
+    }
+
+    return MakeRides(*route_edges);
+}
+
+std::optional<route::TransportRouter::WalkRoute> MappedBase::BuildRoute(
+    const std::vector<route::WalkStop>& sources, const std::vector<route::WalkStop>& targets) const {
+
+    auto route = GetDijkstraRouter().BuildRoute(route::MakeTerminals(sources), route::MakeTerminals(targets));
+
+    if (!route) {
+        return std::nullopt;
+    }
+
+    return route::TransportRouter::WalkRoute{static_cast<transport::StopId>(route->from),
+        static_cast<transport::StopId>(route->to), route->weight.total_time, MakeRides(route->edges)};
+}
+
+std::vector<std::optional<route::TransportRouter::RouteTime>> MappedBase::BuildRoutes(
+    transport::StopId from, const std::vector<transport::StopId>& to, bool with_rides) const {
+
+    const std::vector<graph::VertexId> targets(to.begin(), to.end());
+    auto routes = GetDijkstraRouter().BuildRoutes(from, targets, with_rides);
+
+    std::vector<std::optional<route::TransportRouter::RouteTime>> result;
+    result.reserve(routes.size());
+
+    for (auto& route : routes) {
+        if (!route) {
+            result.emplace_back(std::nullopt);
+            continue;
+        }
+
+        route::TransportRouter::RouteTime route_time{route->weight.total_time, {}};
+
+        if (with_rides) {
+            route_time.rides = MakeRides(route->edges);
+        }
+
+        result.push_back(std::move(route_time));
+    }
+
+    return result;
+}
+
+std::vector<route::ReachedStop> MappedBase::FindReachableStops(transport::StopId from, double max_time) const {
+    return route::MakeReachedStops(GetDijkstraRouter().FindReachable(from, route::RouteWeight{{}, max_time, 0}),
+        GetCount<mapped::Stop>(header_->stops));
+}
+
+std::optional<route::RouteSettings> MappedBase::GetRouteSettings() const {
+    if (!header_->has_route_settings) {
+        return std::nullopt;
+    }
+
+    const auto* mapped_settings = GetArray<mapped::RouteSettings>(header_->route_settings);
+
+    route::RouteSettings settings;
+    settings.bus_wait_time = mapped_settings->bus_wait_time;
+    settings.bus_velocity = mapped_settings->bus_velocity;
+    settings.mode = static_cast<route::RouterMode>(mapped_settings->mode);
+    settings.graph_model = static_cast<route::GraphModel>(mapped_settings->graph_model);
+    settings.walk_velocity = mapped_settings->walk_velocity;
+    settings.max_walk_distance = mapped_settings->max_walk_distance;
+
+    return settings;
+}
+
+std::optional<transport::renderer::RenderSettings> MappedBase::GetRenderSettings() const {
+    if (header_->render_settings.size == 0) {
+        return std::nullopt;
+    }
+
+    proto_map_renderer::RenderSettings proto_settings;
+
+    if (!proto_settings.ParseFromArray(data_ + header_->render_settings.offset,
+                                       static_cast<int>(header_->render_settings.size))) {
+        throw std::runtime_error("wrong render settings in base file"s);
+    }
+
+    return Serializator::MakeRenderSettings(proto_settings);
+}
+
+std::optional<std::string_view> MappedBase::GetMapSvg() const {
+    if (header_->map_svg.size == 0) {
+        return std::nullopt;
+    }
+
+    return std::string_view(data_ + header_->map_svg.offset, header_->map_svg.size);
+}
+
+void MappedBase::FillCatalogue(transport::TransportCatalogue& catalogue) const {
+    const auto* stops = GetArray<mapped::Stop>(header_->stops);
+    const size_t stops_count = GetCount<mapped::Stop>(header_->stops);
+
+    auto stop_name = [this, stops](uint32_t id) {
+        return std::string(GetString(stops[id].name_offset, stops[id].name_size));
+    };
+
+    for (size_t id = 0; id < stops_count; ++id) {
+        catalogue.AddStop({stop_name(id), stops[id].lat, stops[id].lng});
+    }
+
+    // Номера остановок в образе совпадают с идентификаторами в справочнике
+    const auto* distances = GetArray<mapped::Distance>(header_->distances);
+    const size_t distances_count = GetCount<mapped::Distance>(header_->distances);
+
+    for (size_t i = 0; i < distances_count; ++i) {
+        catalogue.AddDistance(distances[i].from, distances[i].to, distances[i].length);
+    }
+
+    const auto* buses = GetArray<mapped::Bus>(header_->buses);
+    const auto* bus_stops = GetArray<uint32_t>(header_->bus_stops);
+
+    for (size_t i = 0; i < bus_names_.size(); ++i) {
+        const uint32_t* begin = bus_stops + buses[i].stops_begin;
+        const std::vector<transport::StopId> stops(begin, begin + buses[i].stops_count);
+
+        catalogue.AddBus(std::string(bus_names_[i]), stops, buses[i].circular);
+    }
+}
+
+} // serialize
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "map_renderer.h"
+#include "ranges.h"
+#include "stop_index.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace serialize {
+
+/*
+ * Второй формат файла базы: версионированный образ с выровненными массивами,
+ * который отображается в память целиком и читается без разбора и копирования.
+ *
+ * После заголовка идут секции, каждая выровнена на 8 байт:
+ * строки (названия остановок и автобусов), остановки, индекс остановок по названию,
+ * автобусы через остановку, автобусы (в порядке справочника, со статистикой),
+ * индекс автобусов по названию, остановки автобусов, расстояния, сетка индекса остановок (StopIndex),
+ * настройки отрисовки (protobuf),
+ * граф маршрутизатора в виде CSR, матрица ALL_PAIRS, если она была построена,
+ * и заранее отрисованная карта
+ */
+namespace mapped {
+
+inline constexpr char MAGIC[8] = {'T', 'C', 'M', 'A', 'P', 'P', 'E', 'D'};
+inline constexpr uint32_t VERSION = 5;
+
+struct Section {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+struct RouteSettings {
+    int32_t bus_wait_time = 0;
+    int32_t bus_velocity = 0;
+    uint32_t mode = 0;
+    uint32_t graph_model = 0;
+    uint32_t vertex_count = 0;
+    uint32_t has_graph = 0;
+    double walk_velocity = 0;
+    double max_walk_distance = 0;
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version = VERSION;
+    uint32_t has_route_settings = 0;
+
+    Section strings;
+    Section stops;
+    Section stops_by_name;
+    Section stop_buses;
+    Section buses;
+    Section buses_by_name;
+    Section bus_stops;
+    Section distances;
+    Section stop_index_grid;
+    Section stop_index_offsets;
+    Section stop_index_entries;
+    Section render_settings;
+    Section route_settings;
+    Section edges;
+    Section incidence_offsets;
+    Section incidence_edges;
+    Section vertex_stop_ids;
+    Section routes_matrix;
+    Section map_svg;
+};
+
+struct Stop {
+    double lat;
+    double lng;
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t buses_begin;
+    uint32_t buses_count;
+};
+
+struct Bus {
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t stops_begin;
+    uint32_t stops_count;
+    uint32_t circular;
+    int32_t all_stops;
+    int32_t unique_stops;
+    uint32_t length;
+    double curvature;
+};
+
+struct Distance {
+    uint32_t from;
+    uint32_t to;
+    int32_t length;
+    uint32_t reserved = 0;
+};
+
+struct Edge {
+    uint32_t from;
+    uint32_t to;
+    uint32_t bus;
+    int32_t span_count;
+    double total_time;
+};
+
+// Граф маршрутизатора поверх отображённого файла: повторяет интерфейс
+// чтения graph::DirectedWeightedGraph, рёбра собираются на лету
+class Graph {
+public:
+    using IncidentEdgesRange = ranges::Range<const uint32_t*>;
+
+    Graph(const Edge* edges, size_t edge_count, const uint32_t* incidence_offsets,
+        const uint32_t* incidence_edges, size_t vertex_count, const std::string_view* bus_names);
+
+    size_t GetVertexCount() const;
+    size_t GetEdgeCount() const;
+    graph::Edge<route::RouteWeight> GetEdge(graph::EdgeId edge_id) const;
+    IncidentEdgesRange GetIncidentEdges(graph::VertexId vertex) const;
+
+private:
+    const Edge* edges_;
+    size_t edge_count_;
+    const uint32_t* incidence_offsets_;
+    const uint32_t* incidence_edges_;
+    size_t vertex_count_;
+    const std::string_view* bus_names_;
+};
+
+// Содержимое файла базы: отображение в память, а где mmap нет — копия в буфере.
+// Отображение снимается в деструкторе
+class FileImage {
+public:
+    explicit FileImage(const std::filesystem::path& file);
+    ~FileImage();
+
+    FileImage(const FileImage&) = delete;
+    FileImage& operator=(const FileImage&) = delete;
+
+    const char* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buffer_;
+};
+
+} // mapped
+
+class MappedBase final {
+public:
+    using TransportRoute = route::TransportRouter::TransportRoute;
+
+    // Отображает файл в память и проверяет заголовок, границы секций
+    // и все номера и смещения внутри них
+    explicit MappedBase(const std::filesystem::path& file);
+
+    MappedBase(const MappedBase&) = delete;
+    MappedBase& operator=(const MappedBase&) = delete;
+
+    static bool Save(const std::filesystem::path& file,
+        const transport::TransportCatalogue& catalogue,
+        const std::optional<transport::renderer::RenderSettings>& render_settings,
+        const route::TransportRouter* router,
+        const transport::StopIndex& stop_index,
+        std::string_view map_svg = {});
+
+    std::optional<transport::BusStat> GetBusStat(std::string_view name) const;
+    std::optional<std::vector<std::string_view>> GetBusesThroughStop(std::string_view name) const;
+
+    // Индекс смотрит прямо в отображённый файл
+    const transport::StopIndex& GetStopIndex() const;
+    std::string_view GetStopName(transport::StopId id) const;
+    std::optional<uint32_t> FindStop(std::string_view name) const;
+
+    bool HasGraph() const;
+    std::optional<TransportRoute> BuildRoute(std::string_view from, std::string_view to) const;
+    std::optional<route::TransportRouter::WalkRoute> BuildRoute(const std::vector<route::WalkStop>& sources,
+        const std::vector<route::WalkStop>& targets) const;
+    std::vector<std::optional<route::TransportRouter::RouteTime>> BuildRoutes(transport::StopId from,
+        const std::vector<transport::StopId>& to, bool with_rides) const;
+    std::vector<route::ReachedStop> FindReachableStops(transport::StopId from, double max_time) const;
+
+    std::optional<route::RouteSettings> GetRouteSettings() const;
+    std::optional<transport::renderer::RenderSettings> GetRenderSettings() const;
+    // Готовый SVG карты прямо из отображённого файла
+    std::optional<std::string_view> GetMapSvg() const;
+
+    // Переносит остановки, расстояния и автобусы в обычный справочник
+    // (нужен, например, для отрисовки карты)
+    void FillCatalogue(transport::TransportCatalogue& catalogue) const;
+
+private:
+    using DijkstraRouter = graph::DijkstraRouter<route::RouteWeight, mapped::Graph>;
+
+    template <typename T>
+    const T* GetArray(const mapped::Section& section) const;
+
+    template <typename T>
+    size_t GetCount(const mapped::Section& section) const;
+
+    // Проверки образа, после которых чтение по номерам из файла не выходит за секции
+    bool IsValid() const;
+    bool IsGraphValid() const;
+
+    std::string_view GetString(uint32_t offset, uint32_t size) const;
+    const mapped::Bus* FindBus(std::string_view name) const;
+    // Строит маршрутизатор по графу образа при первом обращении
+    const DijkstraRouter& GetDijkstraRouter() const;
+    std::optional<std::vector<graph::EdgeId>> FindRouteEdges(graph::VertexId from, graph::VertexId to) const;
+    TransportRoute MakeRides(const std::vector<graph::EdgeId>& edges) const;
+
+    mapped::FileImage image_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const mapped::Header* header_ = nullptr;
+
+    std::vector<std::string_view> bus_names_;
+    std::unique_ptr<mapped::Graph> graph_;
+    transport::StopIndex stop_index_;
+    mutable std::unique_ptr<DijkstraRouter> dijkstra_router_;
+    mutable std::once_flag dijkstra_router_once_;
+};
+
+} // serialize
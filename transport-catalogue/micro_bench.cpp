@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_utils.h"
+#include "city_generator.h"
+#include "geo.h"
+#include "json.h"
+#include "json_reader.h"
+#include "map_renderer.h"
+#include "svg.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+// Микробенчмарки горячих функций на синтетическом городе из city_generator.h.
+// Каждый замер: warmup выборок вхолостую, затем repetitions выборок;
+// выборка — batch вызовов подряд, её время делится на batch.
+// Usage:
+//   micro_bench [--repetitions N] [--warmup N] [--filter substring]
+//               [--format table|json|csv] [--output file]
+//               [--stops N] [--buses N] [--route-length N] [--seed N]
+// Вывод json и csv предназначен для сравнения прогонов разных версий
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+struct Options {
+    int repetitions = 30;
+    int warmup = 3;
+    string filter;
+    string format = "table"s;
+    string output;
+    bench::CityConfig city;
+};
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i += 2) {
+        const string_view option(argv[i]);
+
+        if (i + 1 >= argc) {
+            throw invalid_argument("No value for "s + argv[i]);
+        }
+        const string value(argv[i + 1]);
+
+        if (option == "--repetitions"sv) {
+            options.repetitions = stoi(value);
+        } else if (option == "--warmup"sv) {
+            options.warmup = stoi(value);
+        } else if (option == "--filter"sv) {
+            options.filter = value;
+        } else if (option == "--format"sv) {
+            options.format = value;
+        } else if (option == "--output"sv) {
+            options.output = value;
+        } else if (option == "--stops"sv) {
+            options.city.stops = stoi(value);
+        } else if (option == "--buses"sv) {
+            options.city.buses = stoi(value);
+        } else if (option == "--route-length"sv) {
+            options.city.route_length = stoi(value);
+        } else if (option == "--seed"sv) {
+            options.city.seed = static_cast<unsigned>(stoul(value));
+        } else {
+            throw invalid_argument("Unknown option "s + argv[i]);
+        }
+    }
+
+    if (options.repetitions < 1 || options.warmup < 0) {
+        throw invalid_argument("Need at least one repetition"s);
+    }
+    if (options.format != "table"s && options.format != "json"s && options.format != "csv"s) {
+        throw invalid_argument("Unknown format "s + options.format);
+    }
+
+    return options;
+}
+
+// Время одного вызова в наносекундах по всем выборкам
+struct Summary {
+    string name;
+    size_t batch = 0;
+    size_t samples = 0;
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double p90 = 0;
+    double max = 0;
+    double stddev = 0;
+};
+
+Summary Summarize(string name, size_t batch, vector<double> samples) {
+    sort(samples.begin(), samples.end());
+
+    Summary summary;
+    summary.name = move(name);
+    summary.batch = batch;
+    summary.samples = samples.size();
+    summary.min = samples.front();
+    summary.max = samples.back();
+
+    const size_t middle = samples.size() / 2;
+    summary.median = samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+    summary.p90 = samples[min(samples.size() - 1, static_cast<size_t>(ceil(samples.size() * 0.9)) - 1)];
+    summary.mean = accumulate(samples.begin(), samples.end(), 0.) / samples.size();
+
+    double squares = 0;
+    for (double sample : samples) {
+        squares += (sample - summary.mean) * (sample - summary.mean);
+    }
+    summary.stddev = samples.size() > 1 ? sqrt(squares / (samples.size() - 1)) : 0;
+
+    return summary;
+}
+
+class MicroBench {
+public:
+    explicit MicroBench(const Options& options) : options_(options) {
+    }
+
+    // run(i) — i-й вызов выборки, i из [0, batch)
+    void Run(string name, size_t batch, const function<void(size_t)>& run) {
+        if (!options_.filter.empty() && name.find(options_.filter) == string::npos) {
+            return;
+        }
+
+        auto measure = [batch, &run] {
+            const auto start = chrono::steady_clock::now();
+            for (size_t i = 0; i < batch; ++i) {
+                run(i);
+            }
+            const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+            return elapsed.count() / batch;
+        };
+
+        for (int i = 0; i < options_.warmup; ++i) {
+            measure();
+        }
+
+        vector<double> samples;
+        samples.reserve(options_.repetitions);
+
+        for (int i = 0; i < options_.repetitions; ++i) {
+            samples.push_back(measure());
+        }
+
+        results_.push_back(Summarize(move(name), batch, move(samples)));
+    }
+
+    void Print(ostream& out) const {
+        if (options_.format == "json"s) {
+            PrintJson(out);
+        } else if (options_.format == "csv"s) {
+            PrintCsv(out);
+        } else {
+            PrintTable(out);
+        }
+    }
+
+private:
+    void PrintTable(ostream& out) const {
+        out << left << setw(36) << "benchmark, ns per call"sv << right << setw(8) << "batch"sv
+            << setw(12) << "min"sv << setw(12) << "median"sv << setw(12) << "mean"sv
+            << setw(12) << "p90"sv << setw(12) << "max"sv << setw(12) << "stddev"sv << '\n';
+
+        out << fixed << setprecision(1);
+
+        for (const auto& result : results_) {
+            out << left << setw(36) << result.name << right << setw(8) << result.batch
+                << setw(12) << result.min << setw(12) << result.median << setw(12) << result.mean
+                << setw(12) << result.p90 << setw(12) << result.max << setw(12) << result.stddev << '\n';
+        }
+
+        out << defaultfloat;
+    }
+
+    void PrintCsv(ostream& out) const {
+        out << "name,batch,samples,min_ns,median_ns,mean_ns,p90_ns,max_ns,stddev_ns\n"sv;
+        out.precision(10);
+
+        for (const auto& result : results_) {
+            out << result.name << ',' << result.batch << ',' << result.samples << ','
+                << result.min << ',' << result.median << ',' << result.mean << ','
+                << result.p90 << ',' << result.max << ',' << result.stddev << '\n';
+        }
+    }
+
+    void PrintJson(ostream& out) const {
+        out.precision(10);
+        json::Writer writer(out);
+
+        writer.StartDict()
+            .Key("config"sv).StartDict()
+                .Key("buses"sv).Value(options_.city.buses)
+                .Key("repetitions"sv).Value(options_.repetitions)
+                .Key("route_length"sv).Value(options_.city.route_length)
+                .Key("seed"sv).Value(static_cast<int>(options_.city.seed))
+                .Key("stops"sv).Value(options_.city.stops)
+                .Key("warmup"sv).Value(options_.warmup)
+            .EndDict()
+            .Key("benchmarks"sv).StartArray();
+
+        for (const auto& result : results_) {
+            writer.StartDict()
+                .Key("batch"sv).Value(static_cast<int>(result.batch))
+                .Key("max_ns"sv).Value(result.max)
+                .Key("mean_ns"sv).Value(result.mean)
+                .Key("median_ns"sv).Value(result.median)
+                .Key("min_ns"sv).Value(result.min)
+                .Key("name"sv).Value(result.name)
+                .Key("p90_ns"sv).Value(result.p90)
+                .Key("samples"sv).Value(static_cast<int>(result.samples))
+                .Key("stddev_ns"sv).Value(result.stddev)
+                .EndDict();
+        }
+
+        writer.EndArray().EndDict();
+        out << '\n';
+    }
+
+    const Options& options_;
+    vector<Summary> results_;
+};
+
+int RunAll(const Options& options) {
+    using namespace transport;
+
+    bench::CityGenerator city(options.city);
+    ostringstream make_text;
+    city.WriteMakeBase(make_text);
+
+    istringstream make_input(make_text.str());
+    const JsonReader reader(make_input);
+
+    TransportCatalogue catalogue;
+    reader.FillCatalogue(catalogue);
+
+    mt19937 generator(options.city.seed);
+    uniform_int_distribution<StopId> stop_id(0, catalogue.GetStopsSize() - 1);
+
+    bench::NullBuffer null_buffer;
+    ostream null_output(&null_buffer);
+
+    MicroBench micro_bench(options);
+
+    {
+        constexpr size_t PAIRS = 1024;
+        vector<pair<geo::Coordinates, geo::Coordinates>> pairs;
+
+        for (size_t i = 0; i < PAIRS; ++i) {
+            pairs.emplace_back(catalogue.GetStopById(stop_id(generator)).coordinates,
+                catalogue.GetStopById(stop_id(generator)).coordinates);
+        }
+
+        micro_bench.Run("geo::ComputeDistance"s, PAIRS, [&pairs](size_t i) {
+            bench::DoNotOptimize(geo::ComputeDistance(pairs[i].first, pairs[i].second));
+        });
+    }
+
+    {
+        // Длины маршрутов по карте: поштучно и одним проходом по вершинам
+        vector<vector<geo::Coordinates>> routes;
+        vector<geo::PathPoints> paths;
+
+        for (const Bus& bus : catalogue.GetBuses()) {
+            vector<geo::Coordinates>& route = routes.emplace_back();
+            geo::PathPoints& path = paths.emplace_back();
+
+            for (const Stop* stop : bus.bus_stops) {
+                route.push_back(stop->coordinates);
+                path.Add(stop->coordinates, geo::ComputeLatitudeTrig(stop->coordinates.lat));
+            }
+        }
+
+        micro_bench.Run("route length, geo::ComputeDistance"s, routes.size(), [&routes](size_t i) {
+            double length = 0;
+            for (size_t j = 1; j < routes[i].size(); ++j) {
+                length += geo::ComputeDistance(routes[i][j - 1], routes[i][j]);
+            }
+            bench::DoNotOptimize(length);
+        });
+
+        micro_bench.Run("route length, geo::ComputePathLength"s, paths.size(), [&paths](size_t i) {
+            bench::DoNotOptimize(geo::ComputePathLength(paths[i]));
+        });
+    }
+
+    micro_bench.Run("TransportCatalogue::CalculateStat"s, catalogue.GetBusesSize(), [&catalogue](size_t i) {
+        bench::DoNotOptimize(catalogue.ComputeBusStat(static_cast<BusId>(i)));
+    });
+
+    {
+        route::RouteSettings settings = reader.GetRouteSettings();
+        settings.mode = route::RouterMode::ALL_PAIRS;
+        settings.graph_model = route::GraphModel::STOP_PAIRS;
+
+        route::TransportRouter transport_router(catalogue, settings);
+        transport_router.InitRouter();
+        const auto& router = *transport_router.GetRouter();
+
+        constexpr size_t ROUTES = 256;
+        vector<pair<StopId, StopId>> routes;
+
+        for (size_t i = 0; i < ROUTES; ++i) {
+            routes.emplace_back(stop_id(generator), stop_id(generator));
+        }
+
+        micro_bench.Run("graph::Router::BuildRoute"s, ROUTES, [&router, &routes](size_t i) {
+            bench::DoNotOptimize(router.BuildRoute(routes[i].first, routes[i].second));
+        });
+    }
+
+    {
+        // Ломаные линии маршрутов в проекции карты, как их рисует MapRenderer
+        const auto& stops = city.GetStops();
+        const auto render_settings = *reader.GetRenderSettings();
+        const SphereProjector proj(stops.begin(), stops.end(),
+            render_settings.width, render_settings.height, render_settings.padding);
+
+        vector<svg::Polyline> lines;
+
+        for (const Bus& bus : catalogue.GetBuses()) {
+            svg::Polyline line;
+
+            for (const Stop* stop : bus.bus_stops) {
+                line.AddPoint(proj(stop->coordinates));
+            }
+
+            line.SetFillColor(svg::NoneColor)
+                .SetStrokeColor("green"s)
+                .SetStrokeWidth(render_settings.line_width)
+                .SetStrokeLineCap(svg::StrokeLineCap::ROUND)
+                .SetStrokeLineJoin(svg::StrokeLineJoin::ROUND);
+
+            lines.push_back(move(line));
+        }
+
+        // RenderObject закрыт, его вызывает Object::Render с отступом из контекста
+        const svg::RenderContext context(null_output, 2, 2);
+
+        micro_bench.Run("svg::Polyline::RenderObject"s, lines.size(), [&lines, &context](size_t i) {
+            lines[i].Render(context);
+        });
+    }
+
+    {
+        istringstream input(make_text.str());
+        const json::Document document = json::Load(input);
+
+        micro_bench.Run("json::Print"s, 1, [&document, &null_output](size_t) {
+            json::Print(document, null_output);
+        });
+    }
+
+    if (options.output.empty()) {
+        micro_bench.Print(cout);
+        return 0;
+    }
+
+    ofstream out(options.output);
+    micro_bench.Print(out);
+
+    if (!out) {
+        cerr << "Can't write "sv << options.output << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        return RunAll(ParseOptions(argc, argv));
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,103 @@
+#include "profile.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "json.h"
+
+using namespace std;
+using namespace std::literals;
+
+namespace profile {
+
+namespace {
+
+struct Timer {
+    int64_t calls = 0;
+    chrono::nanoseconds total{0};
+    chrono::nanoseconds max{0};
+};
+
+// Замеры приходят и из потоков пула, поэтому общее хранилище под мьютексом;
+// при выключенном сборе сюда никто не заходит
+struct Storage {
+    mutex guard;
+    map<string, Timer, less<>> timers;
+    map<string, int64_t, less<>> counters;
+};
+
+Storage& GetStorage() {
+    static Storage storage;
+    return storage;
+}
+
+double ToMilliseconds(chrono::nanoseconds duration) {
+    return chrono::duration<double, milli>(duration).count();
+}
+
+} // namespace
+
+void Enable() {
+    is_enabled.store(true, memory_order_relaxed);
+}
+
+void AddTime(string_view name, string_view suffix, chrono::nanoseconds elapsed) {
+    string key;
+    key.reserve(name.size() + suffix.size());
+    key.append(name).append(suffix);
+
+    Storage& storage = GetStorage();
+    lock_guard lock(storage.guard);
+
+    Timer& timer = storage.timers[move(key)];
+    ++timer.calls;
+    timer.total += elapsed;
+    timer.max = std::max(timer.max, elapsed);
+}
+
+void AddCount(string_view name, int64_t value) {
+    Storage& storage = GetStorage();
+    lock_guard lock(storage.guard);
+
+    const auto it = storage.counters.find(name);
+
+    if (it == storage.counters.end()) {
+        storage.counters.emplace(string(name), value);
+    } else {
+        it->second += value;
+    }
+}
+
+void WriteReport(ostream& out) {
+    Storage& storage = GetStorage();
+    lock_guard lock(storage.guard);
+
+    // Счётчики и число вызовов пишутся как double, без экспоненты
+    const auto precision = out.precision(15);
+    json::Writer writer(out);
+
+    writer.StartDict().Key("counters"sv).StartDict();
+
+    for (const auto& [name, value] : storage.counters) {
+        // Счётчики — размеры и количества, в int помещаются не всегда
+        writer.Key(name).Value(static_cast<double>(value));
+    }
+
+    writer.EndDict().Key("timers"sv).StartDict();
+
+    for (const auto& [name, timer] : storage.timers) {
+        writer.Key(name).StartDict()
+            .Key("calls"sv).Value(static_cast<double>(timer.calls))
+            .Key("max_ms"sv).Value(ToMilliseconds(timer.max))
+            .Key("mean_ms"sv).Value(ToMilliseconds(timer.total) / timer.calls)
+            .Key("total_ms"sv).Value(ToMilliseconds(timer.total))
+            .EndDict();
+    }
+
+    writer.EndDict().EndDict();
+    out << endl;
+    out.precision(precision);
+}
+
+} // namespace profile
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+namespace profile {
+
+// Сбор замеров по этапам: суммарное и максимальное время именованных участков
+// и счётчики. Пока сбор не включён, таймер и счётчик — одна проверка флага,
+// без чтения часов и без блокировок. Включается один раз при старте,
+// до появления рабочих потоков
+void Enable();
+
+inline std::atomic<bool> is_enabled{false};
+
+inline bool IsEnabled() {
+    return is_enabled.load(std::memory_order_relaxed);
+}
+
+// Имя участка — name и suffix подряд: suffix позволяет не собирать строку,
+// когда сбор выключен (например, "stat_request " и тип запроса)
+void AddTime(std::string_view name, std::string_view suffix, std::chrono::nanoseconds elapsed);
+void AddCount(std::string_view name, int64_t value);
+
+inline void Count(std::string_view name, int64_t value = 1) {
+    if (IsEnabled()) {
+        AddCount(name, value);
+    }
+}
+
+// Отчёт в JSON: {"counters": {...}, "timers": {имя: {"calls", "max_ms", "mean_ms", "total_ms"}}}
+void WriteReport(std::ostream& out);
+
+// Замеряет время жизни объекта
+class ScopedTimer {
+public:
+    explicit ScopedTimer(std::string_view name, std::string_view suffix = {})
+        : is_enabled_(IsEnabled()) {
+
+        if (is_enabled_) {
+            name_ = name;
+            suffix_ = suffix;
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (is_enabled_) {
+            AddTime(name_, suffix_, std::chrono::steady_clock::now() - start_);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    bool is_enabled_;
+    std::string_view name_;
+    std::string_view suffix_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace profile
@@ -1,5 +1,14 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <numeric>
 #include <sstream>
+#include <tuple>
 
+#include "profile.h"
 #include "request_handler.h"
 
 /*
@@ -18,6 +27,11 @@ namespace transport {
 }
 
 void RequestHandler::SetRenderer(renderer::RenderSettings settings) {
+    InitRenderer(move(settings));
+    map_svg_.reset();
+}
+
+void RequestHandler::InitRenderer(renderer::RenderSettings settings) const {
     vector<geo::Coordinates> all_coords;
 
     vector<const Bus*> buses;
@@ -53,26 +67,115 @@ void RequestHandler::SetRenderer(renderer::RenderSettings settings) {
     renderer_ = make_unique<renderer::MapRenderer>(move(proj), move(settings), move(buses), move(stops_vec));
 }
 
+void RequestHandler::FillCatalogueFromMappedBase() const {
+    lock_guard guard(catalogue_mutex_);
+
+    if (mapped_base_ && !is_catalogue_filled_) {
+        mapped_base_->FillCatalogue(const_cast<TransportCatalogue&>(db_));
+        is_catalogue_filled_ = true;
+    }
+}
+
 optional<BusStat> RequestHandler::GetBusStat(const string& bus_name) const {
+    if (mapped_base_) {
+        return mapped_base_->GetBusStat(bus_name);
+    }
     return db_.GetBusStat(bus_name);
 }
 
-const set<string_view>* RequestHandler::GetBusesThroughStop(const string& stop_name) const {
-    return db_.GetBusesThroughStop(stop_name);
+optional<vector<string_view>> RequestHandler::GetBusesThroughStop(const string& stop_name) const {
+    if (mapped_base_) {
+        return mapped_base_->GetBusesThroughStop(stop_name);
+    }
+
+    const auto* stop_buses = db_.GetBusesThroughStop(stop_name);
+
+    if (!stop_buses) {
+        return nullopt;
+    }
+    return vector<string_view>(stop_buses->begin(), stop_buses->end());
 }
 
 const svg::Document& RequestHandler::RenderMap() const {
-    renderer_->AddLinesToSvg();
-    renderer_->AddBusLabelsToSvg();
-    renderer_->AddStopSymToSvg();
-    renderer_->AddStopLabelsToSvg();
+    if (!renderer_ && mapped_render_settings_) {
+        FillCatalogueFromMappedBase();
+        InitRenderer(*mapped_render_settings_);
+    }
 
-    return renderer_->GetSvgDoc();
+    return renderer_->RenderSvgDoc();
+}
+
+string_view RequestHandler::GetMapSvg() const {
+    lock_guard guard(map_mutex_);
+
+    if (!map_svg_) {
+        const auto start = chrono::steady_clock::now();
+
+        profile::ScopedTimer timer("MapRenderer::Render"sv);
+
+        stringstream map_string;
+        RenderMap().Render(map_string);
+        map_svg_storage_ = map_string.str();
+        map_svg_ = map_svg_storage_;
+
+        if (report_stats_) {
+            const auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+            cerr << "Map rendered in "s << elapsed.count() << " ms, "s
+                 << map_svg_storage_.size() << " bytes"s << endl;
+        }
+    }
+
+    return *map_svg_;
+}
+
+const StopIndex& RequestHandler::GetStopIndex() const {
+    if (mapped_base_) {
+        return mapped_base_->GetStopIndex();
+    }
+
+    lock_guard guard(stop_index_mutex_);
+
+    if (!stop_index_) {
+        stop_index_ = StopIndex::Build(db_);
+    }
+
+    return *stop_index_;
+}
+
+vector<pair<string_view, double>> RequestHandler::FindNearbyStops(geo::Coordinates point,
+    size_t count, double max_distance) const {
+
+    const auto found = GetStopIndex().FindNearest(point, count, max_distance);
+
+    vector<pair<string_view, double>> result;
+    result.reserve(found.size());
+
+    for (const auto& [stop_id, distance] : found) {
+        result.emplace_back(GetStopName(stop_id), distance);
+    }
+
+    return result;
+}
+
+optional<StopId> RequestHandler::FindStopId(string_view name) const {
+    if (mapped_base_) {
+        return mapped_base_->FindStop(name);
+    }
+    return db_.FindStopId(name);
+}
+
+string_view RequestHandler::GetStopName(StopId id) const {
+    if (mapped_base_) {
+        return mapped_base_->GetStopName(id);
+    }
+    return db_.GetStopById(id).name;
 }
 
 bool RequestHandler::ResetRouter() const {
     if (routing_settings_) {
         router_ = std::make_unique<route::TransportRouter>(db_, routing_settings_.value());
+        router_->SetThreadsCount(threads_count_);
+        router_->SetReportStats(report_stats_);
         return true;
     } else {
         std::cerr << "Can't find routing settings"s << std::endl;
@@ -89,155 +192,759 @@ bool RequestHandler::SetRouter() const {
 
 std::optional<RequestHandler::Route>
 RequestHandler::BuildRoute(const std::string &from, const std::string &to) const {
-    if (!SetRouter()) {
+    if (mapped_base_) {
+        if (mapped_base_->HasGraph()) {
+            return mapped_base_->BuildRoute(from, to);
+        }
+        // Графа в файле нет — строим маршрутизатор по справочнику, как для protobuf
+        FillCatalogueFromMappedBase();
+    }
+
+    if (!PrepareRouter()) {
         return std::nullopt;
+    }
+
+    return router_->BuildRoute(from, to);
+}
+
+vector<StopIndex::Found> RequestHandler::FindWalkStops(const RoutePoint& point) const {
+    if (const auto* name = get_if<string>(&point)) {
+        const auto stop_id = FindStopId(*name);
+
+        if (!stop_id) {
+            return {};
+        }
+        return {StopIndex::Found{*stop_id, 0}};
+    }
+
+    return GetStopIndex().FindNearest(get<geo::Coordinates>(point), numeric_limits<size_t>::max(),
+        routing_settings_->max_walk_distance);
+}
+
+optional<route::TransportRouter::WalkRoute> RequestHandler::BuildWalkRoute(
+    const vector<route::WalkStop>& sources, const vector<route::WalkStop>& targets) const {
+
+    if (mapped_base_) {
+        if (mapped_base_->HasGraph()) {
+            return mapped_base_->BuildRoute(sources, targets);
+        }
+        FillCatalogueFromMappedBase();
+    }
+
+    if (!PrepareDijkstraRouter()) {
+        return nullopt;
+    }
+
+    return router_->BuildRoute(sources, targets);
+}
+
+optional<RequestHandler::PointsRoute> RequestHandler::BuildRoute(const RoutePoint& from, const RoutePoint& to) const {
+    if (!routing_settings_) {
+        return nullopt;
+    }
+
+    // Метров в минуту
+    const double walk_speed = routing_settings_->walk_velocity * 1000.0 / 60.0;
+
+    const auto from_stops = FindWalkStops(from);
+    const auto to_stops = FindWalkStops(to);
+
+    optional<PointsRoute> result;
+
+    if (!from_stops.empty() && !to_stops.empty()) {
+        auto to_walk_stops = [walk_speed](const vector<StopIndex::Found>& found) {
+            vector<route::WalkStop> walk_stops;
+            walk_stops.reserve(found.size());
+
+            for (const auto& [stop_id, distance] : found) {
+                walk_stops.push_back({stop_id, distance / walk_speed});
+            }
+            return walk_stops;
+        };
+
+        if (auto route = BuildWalkRoute(to_walk_stops(from_stops), to_walk_stops(to_stops))) {
+            auto make_leg = [this, walk_speed](const vector<StopIndex::Found>& found, StopId stop_id) {
+                const auto it = find_if(found.begin(), found.end(), [stop_id](const StopIndex::Found& item) {
+                    return item.stop_id == stop_id;
+                });
+                return WalkLeg{GetStopName(stop_id), it->distance, it->distance / walk_speed};
+            };
+
+            result = PointsRoute{};
+            result->rides = move(route->rides);
+            result->total_time = route->total_time;
+
+            if (holds_alternative<geo::Coordinates>(from)) {
+                result->walk_to_stop = make_leg(from_stops, route->from_stop);
+            }
+            if (holds_alternative<geo::Coordinates>(to)) {
+                result->walk_from_stop = make_leg(to_stops, route->to_stop);
+            }
+        }
+    }
+
+    // Между близкими точками можно дойти пешком, не садясь в автобус
+    if (holds_alternative<geo::Coordinates>(from) && holds_alternative<geo::Coordinates>(to)) {
+        const double distance = geo::ComputeDistance(get<geo::Coordinates>(from), get<geo::Coordinates>(to));
+        const double time = distance / walk_speed;
+
+        if (distance <= routing_settings_->max_walk_distance && (!result || time <= result->total_time)) {
+            result = PointsRoute{WalkLeg{{}, distance, time}, {}, nullopt, time};
+        }
+    }
+
+    return result;
+}
+
+vector<RequestHandler::RouteMatrixRow> RequestHandler::BuildRouteMatrix(const vector<string_view>& from,
+    const vector<string_view>& to, bool with_rides) const {
+
+    vector<RouteMatrixRow> result(from.size(), RouteMatrixRow(to.size()));
+
+    // Поиск идёт только до известных остановок, ответы раскладываются по их столбцам
+    vector<StopId> targets;
+    vector<size_t> target_columns;
+
+    for (size_t column = 0; column < to.size(); ++column) {
+        if (const auto stop_id = FindStopId(to[column])) {
+            targets.push_back(*stop_id);
+            target_columns.push_back(column);
+        }
+    }
+
+    if (targets.empty()) {
+        return result;
+    }
+
+    const bool use_mapped_graph = mapped_base_ && mapped_base_->HasGraph();
+
+    if (!use_mapped_graph) {
+        if (mapped_base_) {
+            FillCatalogueFromMappedBase();
+        }
+        if (!PrepareDijkstraRouter()) {
+            return result;
+        }
+    }
+
+    GetPool().ParallelFor(from.size(), [&](size_t row) {
+        const auto source = FindStopId(from[row]);
+
+        if (!source) {
+            return;
+        }
+
+        auto routes = use_mapped_graph ? mapped_base_->BuildRoutes(*source, targets, with_rides)
+                                       : router_->BuildRoutes(*source, targets, with_rides);
+
+        for (size_t i = 0; i < routes.size(); ++i) {
+            result[row][target_columns[i]] = move(routes[i]);
+        }
+    });
+
+    return result;
+}
+
+optional<vector<pair<string_view, double>>> RequestHandler::FindReachableStops(string_view from,
+    double max_time) const {
+
+    const auto stop_id = FindStopId(from);
+
+    if (!stop_id) {
+        return nullopt;
+    }
+
+    const bool use_mapped_graph = mapped_base_ && mapped_base_->HasGraph();
+
+    if (!use_mapped_graph) {
+        if (mapped_base_) {
+            FillCatalogueFromMappedBase();
+        }
+        if (!PrepareDijkstraRouter()) {
+            return nullopt;
+        }
+    }
+
+    const auto reached = use_mapped_graph ? mapped_base_->FindReachableStops(*stop_id, max_time)
+                                          : router_->FindReachableStops(*stop_id, max_time);
+
+    vector<pair<string_view, double>> result;
+    result.reserve(reached.size());
+
+    for (const auto& [reached_id, time] : reached) {
+        result.emplace_back(GetStopName(reached_id), time);
+    }
+
+    // Поиск выдаёт остановки по времени; при равном времени порядок — по названию
+    stable_sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+        return tie(lhs.second, lhs.first) < tie(rhs.second, rhs.first);
+    });
+
+    return result;
+}
+
+optional<string> RequestHandler::RenderIsochrone(const vector<pair<string_view, double>>& stops,
+    double max_time) const {
+
+    // Без базы формата MAPPED отрисовщик создаётся до ответов на запросы
+    if (mapped_base_ ? !mapped_render_settings_ : !renderer_) {
+        return nullopt;
+    }
+
+    // Слою нужны остановки справочника и проекция карты
+    FillCatalogueFromMappedBase();
+
+    vector<pair<const Stop*, double>> stop_times;
+    stop_times.reserve(stops.size());
+
+    for (const auto& [name, time] : stops) {
+        stop_times.emplace_back(&db_.GetStopById(*db_.FindStopId(name)), time);
+    }
+
+    stringstream svg_string;
+    lock_guard guard(map_mutex_);
+
+    if (!renderer_) {
+        InitRenderer(*mapped_render_settings_);
+    }
+
+    renderer_->RenderIsochrone(stop_times, max_time).Render(svg_string);
+
+    return svg_string.str();
+}
+
+concurrency::ThreadPool& RequestHandler::GetPool() const {
+    call_once(pool_once_, [this] {
+        pool_ = make_unique<concurrency::ThreadPool>(threads_count_);
+    });
+    return *pool_;
+}
+
+// После подготовки маршрутизатор только читается, поэтому BuildRoute
+// можно вызывать из нескольких потоков
+bool RequestHandler::PrepareRouter() const {
+    lock_guard guard(router_mutex_);
+
+    if (!SetRouter()) {
+        return false;
+    }
+
+    if (!router_->IsInitialized()) {
+        const auto start = chrono::steady_clock::now();
+        router_->InitRouter();
+
+        if (report_stats_) {
+            const auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+            cerr << "Router prepared on first Route request in "s << elapsed.count() << " ms"s << endl;
+        }
+    }
+
+    return true;
+}
+
+bool RequestHandler::PrepareDijkstraRouter() const {
+    lock_guard guard(router_mutex_);
+
+    if (!SetRouter()) {
+        return false;
+    }
+
+    router_->InitDijkstraRouter();
+
+    return true;
+}
+
+// Ключи каждого ответа пишутся по алфавиту — в том порядке, в котором
+// их выводил json::Print для словаря-ответа
+void RequestHandler::PrintJsonResponse(const json::Array& requests, std::ostream& out) const {
+    json::Writer writer(out);
+
+    writer.StartArray();
+
+    if (concurrency::ResolveThreadsCount(threads_count_) > 1) {
+        WriteResponsesParallel(requests, out.precision(), writer);
     } else {
-        return router_->BuildRoute(from, to);
+        for (const auto& item : requests) {
+            WriteResponse(item.AsDict(), writer);
+        }
+    }
+
+    writer.EndArray();
+}
+
+void RequestHandler::SetLatencyStats(bool enabled) {
+    record_latency_ = enabled;
+}
+
+stats::LatencyHistogram* RequestHandler::GetLatencyHistogram(string_view type) const {
+    if (!record_latency_) {
+        return nullptr;
     }
+
+    const auto it = find(LATENCY_TYPES.begin(), LATENCY_TYPES.end(), type);
+
+    if (it == LATENCY_TYPES.end()) {
+        return nullptr;
+    }
+    return &latencies_[it - LATENCY_TYPES.begin()];
 }
 
-json::Document RequestHandler::GetJsonResponse(const json::Array& requests) const {
-    auto response_builder = json::Builder{};
-    
-    auto arr_ctx = response_builder.StartArray();
-    
-    for (const auto& item : requests) {
+void RequestHandler::WriteLatencyStats(json::Writer& writer, bool with_buckets) const {
+    auto to_ms = [](chrono::nanoseconds duration) {
+        return chrono::duration<double, milli>(duration).count();
+    };
+
+    // Типы выводятся по алфавиту, как ключи словаря
+    vector<size_t> order(LATENCY_TYPES.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [](size_t lhs, size_t rhs) {
+        return LATENCY_TYPES[lhs] < LATENCY_TYPES[rhs];
+    });
 
-        const auto& dict = item.AsDict();
+    writer.StartDict();
 
-        int id = dict.at("id"s).AsInt();
-        const string& type = dict.at("type"s).AsString();
+    for (size_t index : order) {
+        const stats::LatencyHistogram& histogram = latencies_[index];
 
-        if (type == "Bus"s) {
-            const string& name = dict.at("name"s).AsString();
-            const auto bus_stat_opt = GetBusStat(name);
+        if (histogram.GetCount() == 0) {
+            continue;
+        }
+
+        writer.Key(LATENCY_TYPES[index]).StartDict();
+
+        if (with_buckets) {
+            // Корзина — [нижняя граница, верхняя граница, число запросов], в наносекундах
+            writer.Key("buckets"sv).StartArray();
 
-            if (!bus_stat_opt) {     
-                arr_ctx.StartDict()
-                    .Key("request_id"s)
-                    .Value(id)
-                    .Key("error_message"s)
-                    .Value("not found"s)
-                    .EndDict();
-                continue;
+            for (const auto& bucket : histogram.GetBuckets()) {
+                writer.StartArray()
+                    .Value(static_cast<double>(bucket.lower_ns))
+                    .Value(static_cast<double>(bucket.upper_ns))
+                    .Value(static_cast<double>(bucket.count))
+                    .EndArray();
             }
 
-            const auto& bus_stat = bus_stat_opt.value();
-
-            arr_ctx.StartDict()
-                .Key("request_id"s)
-                .Value(id)
-                .Key("curvature"s)
-                .Value(bus_stat.curvature)
-                .Key("stop_count"s)
-                .Value(bus_stat.all_stops)
-                .Key("unique_stop_count"s)
-                .Value(bus_stat.unique_stops)
-                .Key("route_length"s)
-                .Value(static_cast<int>(bus_stat.length))
-                .EndDict();
-        } else if (type == "Stop"s) {
-            const string& name = dict.at("name"s).AsString();
-            auto stop_buses = GetBusesThroughStop(name);
-
-            if (!stop_buses) {
-                arr_ctx.StartDict()
-                    .Key("request_id"s)
-                    .Value(id)
-                    .Key("error_message"s)
-                    .Value("not found"s)
-                    .EndDict();
-                continue;
+            writer.EndArray();
+        }
+
+        writer.Key("count"sv).Value(static_cast<double>(histogram.GetCount()))
+            .Key("max_ms"sv).Value(to_ms(histogram.GetMax()))
+            .Key("mean_ms"sv).Value(to_ms(histogram.GetMean()))
+            .Key("p50_ms"sv).Value(to_ms(histogram.GetQuantile(0.5)))
+            .Key("p999_ms"sv).Value(to_ms(histogram.GetQuantile(0.999)))
+            .Key("p99_ms"sv).Value(to_ms(histogram.GetQuantile(0.99)))
+            .EndDict();
+    }
+
+    writer.EndDict();
+}
+
+void RequestHandler::PrintLatencySummary(ostream& out) const {
+    auto to_ms = [](chrono::nanoseconds duration) {
+        return chrono::duration<double, milli>(duration).count();
+    };
+
+    out << left << setw(14) << "type"sv << right << setw(10) << "count"sv << setw(12) << "p50, ms"sv
+        << setw(12) << "p99, ms"sv << setw(12) << "p999, ms"sv << setw(12) << "max, ms"sv << '\n';
+
+    const auto flags = out.flags();
+    const auto precision = out.precision(4);
+    out << fixed;
+
+    for (size_t index = 0; index < LATENCY_TYPES.size(); ++index) {
+        const stats::LatencyHistogram& histogram = latencies_[index];
+
+        if (histogram.GetCount() == 0) {
+            continue;
+        }
+
+        out << left << setw(14) << LATENCY_TYPES[index] << right << setw(10) << histogram.GetCount()
+            << setw(12) << to_ms(histogram.GetQuantile(0.5))
+            << setw(12) << to_ms(histogram.GetQuantile(0.99))
+            << setw(12) << to_ms(histogram.GetQuantile(0.999))
+            << setw(12) << to_ms(histogram.GetMax()) << '\n';
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+    out << flush;
+}
+
+// Запросы обрабатываются пачками: ответы пачки пишутся в отдельные строки
+// параллельно, затем выводятся по порядку. Память ограничена размером пачки
+void RequestHandler::WriteResponsesParallel(const json::Array& requests, streamsize precision,
+    json::Writer& writer) const {
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    vector<string> responses;
+
+    for (size_t batch_begin = 0; batch_begin < requests.size(); batch_begin += BATCH_SIZE) {
+        const size_t batch_size = min(BATCH_SIZE, requests.size() - batch_begin);
+        responses.assign(batch_size, string{});
+
+        GetPool().ParallelFor(batch_size, [&](size_t index) {
+            ostringstream response;
+            // Числа печатаются с той же точностью, что и при выводе в один поток
+            response.precision(precision);
+            // Ответ — элемент массива верхнего уровня, отсюда второй уровень отступа
+            json::Writer response_writer(response, 2, 2);
+
+            WriteResponse(requests[batch_begin + index].AsDict(), response_writer);
+            responses[index] = response.str();
+        });
+
+        for (const string& response : responses) {
+            writer.RawValue(response);
+        }
+    }
+}
+
+void RequestHandler::WriteResponse(const json::Dict& request, json::Writer& writer) const {
+    int id = request.at("id"s).AsInt();
+    const string& type = request.at("type"s).AsString();
+
+    profile::ScopedTimer timer("stat_request "sv, type);
+    stats::ScopedLatency latency(GetLatencyHistogram(type));
+
+    auto write_not_found = [&writer, id] {
+        profile::Count("stat_requests.not_found"sv);
+        writer.StartDict()
+            .Key("error_message"sv).Value("not found"sv)
+            .Key("request_id"sv).Value(id)
+            .EndDict();
+    };
+
+    if (type == "Bus"s) {
+        const auto bus_stat_opt = GetBusStat(request.at("name"s).AsString());
+
+        if (!bus_stat_opt) {
+            write_not_found();
+            return;
+        }
+
+        const auto& bus_stat = bus_stat_opt.value();
+
+        writer.StartDict()
+            .Key("curvature"sv).Value(bus_stat.curvature)
+            .Key("request_id"sv).Value(id)
+            .Key("route_length"sv).Value(static_cast<int>(bus_stat.length))
+            .Key("stop_count"sv).Value(bus_stat.all_stops)
+            .Key("unique_stop_count"sv).Value(bus_stat.unique_stops)
+            .EndDict();
+    } else if (type == "Stop"s) {
+        const auto stop_buses = GetBusesThroughStop(request.at("name"s).AsString());
+
+        if (!stop_buses) {
+            write_not_found();
+            return;
+        }
+
+        writer.StartDict().Key("buses"sv).StartArray();
+
+        for (string_view bus : *stop_buses) {
+            writer.Value(bus);
+        }
+
+        writer.EndArray()
+            .Key("request_id"sv).Value(id)
+            .EndDict();
+    } else if (type == "Map"s) {
+        writer.StartDict()
+            .Key("map"sv).Value(GetMapSvg())
+            .Key("request_id"sv).Value(id)
+            .EndDict();
+    } else if (type == "Route"s) {
+        const json::Node& from = request.at("from"s);
+        const json::Node& to = request.at("to"s);
+
+        // Концы маршрута — названия остановок или словари {"latitude", "longitude"}
+        auto to_route_point = [](const json::Node& node) -> RoutePoint {
+            if (node.IsString()) {
+                return node.AsString();
+            }
+            const json::Dict& point = node.AsDict();
+            return geo::Coordinates{point.at("latitude"s).AsDouble(), point.at("longitude"s).AsDouble()};
+        };
+
+        optional<PointsRoute> route_data;
+
+        if (from.IsString() && to.IsString()) {
+            if (auto rides = BuildRoute(from.AsString(), to.AsString())) {
+                route_data = PointsRoute{};
+                route_data->rides = move(*rides);
+
+                for (const auto& edge : route_data->rides) {
+                    route_data->total_time += edge.total_time;
+                }
             }
-            
-            arr_ctx.StartDict()
-                .Key("request_id"s)
-                .Value(id)
-                .Key("buses"s)
-                .StartArray();
-
-            for (string_view bus: *stop_buses) {
-                arr_ctx.Value(string(bus));
+        } else {
+            route_data = BuildRoute(to_route_point(from), to_route_point(to));
+        }
+
+        if (!route_data) {
+            write_not_found();
+            return;
+        }
+
+        auto write_walk = [&writer](const WalkLeg& walk) {
+            writer.StartDict().Key("distance"sv).Value(walk.distance);
+
+            if (!walk.stop_name.empty()) {
+                writer.Key("stop_name"sv).Value(walk.stop_name);
             }
-            
-            arr_ctx.EndArray().EndDict();        
-        } else if (type == "Map"s) {
-            stringstream map_string;
-
-            const auto& svg_doc = RenderMap();
-            svg_doc.Render(map_string);
-                 
-            arr_ctx.StartDict()
-                .Key("request_id"s)
-                .Value(id)
-                .Key("map"s)
-                .Value(map_string.str())
+
+            writer.Key("time"sv).Value(walk.time)
+                .Key("type"sv).Value("Walk"sv)
+                .EndDict();
+        };
+
+        writer.StartDict().Key("items"sv).StartArray();
+
+        if (route_data->walk_to_stop) {
+            write_walk(*route_data->walk_to_stop);
+        }
+
+        WriteRides(route_data->rides, writer);
+
+        if (route_data->walk_from_stop) {
+            write_walk(*route_data->walk_from_stop);
+        }
+
+        writer.EndArray()
+            .Key("request_id"sv).Value(id)
+            .Key("total_time"sv).Value(route_data->total_time)
+            .EndDict();
+    } else if (type == "Isochrone"s) {
+        const double max_time = request.at("max_time"s).AsDouble();
+        const auto stops = FindReachableStops(request.at("from"s).AsString(), max_time);
+
+        if (!stops) {
+            write_not_found();
+            return;
+        }
+
+        const auto render_it = request.find("render"s);
+        optional<string> overlay;
+
+        if (render_it != request.end() && render_it->second.AsBool()) {
+            overlay = RenderIsochrone(*stops, max_time);
+        }
+
+        writer.StartDict();
+
+        if (overlay) {
+            writer.Key("map"sv).Value(*overlay);
+        }
+
+        writer.Key("request_id"sv).Value(id)
+            .Key("stops"sv).StartArray();
+
+        for (const auto& [name, time] : *stops) {
+            writer.StartDict()
+                .Key("name"sv).Value(name)
+                .Key("time"sv).Value(time)
                 .EndDict();
-        } else if (type == "Route"s) {
-            auto route_data = BuildRoute(dict.at("from"s).AsString(), dict.at("to"s).AsString());
-
-            if (!route_data) {
-                arr_ctx.StartDict()
-                    .Key("request_id"s)
-                    .Value(id)
-                    .Key("error_message"s)
-                    .Value("not found"s)
-                    .EndDict();
-                continue;
+        }
+
+        writer.EndArray().EndDict();
+    } else if (type == "RouteMatrix"s) {
+        // from и to — списки остановок; times[i][j] — время от from[i] до to[j]
+        // или null, paths (если запрошены) — поездки в формате items ответа Route
+        vector<string_view> from;
+        vector<string_view> to;
+
+        for (const auto& stop : request.at("from"s).AsArray()) {
+            from.push_back(stop.AsString());
+        }
+        for (const auto& stop : request.at("to"s).AsArray()) {
+            to.push_back(stop.AsString());
+        }
+
+        const auto paths_it = request.find("paths"s);
+        const bool with_paths = paths_it != request.end() && paths_it->second.AsBool();
+
+        const auto matrix = BuildRouteMatrix(from, to, with_paths);
+
+        writer.StartDict();
+
+        if (with_paths) {
+            writer.Key("paths"sv).StartArray();
+
+            for (const auto& row : matrix) {
+                writer.StartArray();
+
+                for (const auto& cell : row) {
+                    if (!cell) {
+                        writer.Value(nullptr);
+                        continue;
+                    }
+
+                    writer.StartArray();
+                    WriteRides(cell->rides, writer);
+                    writer.EndArray();
+                }
+
+                writer.EndArray();
             }
 
-            double total_time = 0;
-            int wait_time = router_->GetSettings().bus_wait_time;
-            json::Array items;
+            writer.EndArray();
+        }
 
-            for (const auto &edge : route_data.value()) {
-                total_time += edge.total_time;
+        writer.Key("request_id"sv).Value(id)
+            .Key("times"sv).StartArray();
 
-                json::Node wait_elem = json::Builder{}.StartDict().
-                    Key("type"s).Value("Wait"s).
-                    Key("stop_name"s).Value(std::string(edge.stop_from)).
-                    Key("time"s).Value(wait_time).
-                    EndDict().Build();
-                
-                json::Node ride_elem = json::Builder{}.StartDict().
-                    Key("type"s).Value("Bus"s).
-                    Key("bus"s).Value(std::string(edge.bus_name)).
-                    Key("span_count"s).Value(edge.span_count).
-                    Key("time"s).Value(edge.total_time - wait_time).
-                    EndDict().Build();
-                
-                items.push_back(wait_elem);
-                items.push_back(ride_elem);
+        for (const auto& row : matrix) {
+            writer.StartArray();
+
+            for (const auto& cell : row) {
+                if (cell) {
+                    writer.Value(cell->total_time);
+                } else {
+                    writer.Value(nullptr);
+                }
             }
-            
-            arr_ctx.StartDict()
-                .Key("request_id"s).Value(id)
-                .Key("total_time"s).Value(total_time)
-                .Key("items"s).Value(items)
+
+            writer.EndArray();
+        }
+
+        writer.EndArray().EndDict();
+    } else if (type == "LatencyStats"s) {
+        // Сводка задержек на момент запроса, в serve — за всё время работы
+        const auto buckets_it = request.find("buckets"s);
+        const bool with_buckets = buckets_it != request.end() && buckets_it->second.AsBool();
+
+        writer.StartDict()
+            .Key("request_id"sv).Value(id)
+            .Key("types"sv);
+
+        WriteLatencyStats(writer, with_buckets);
+
+        writer.EndDict();
+    } else if (type == "Nearby"s) {
+        // count — сколько ближайших остановок вернуть, radius — в каком радиусе
+        // искать, в метрах; нужен хотя бы один из них
+        const auto count_it = request.find("count"s);
+        const auto radius_it = request.find("radius"s);
+
+        if (count_it == request.end() && radius_it == request.end()) {
+            throw invalid_argument("Nearby request needs count or radius"s);
+        }
+
+        const geo::Coordinates point{request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble()};
+        const size_t count = count_it != request.end()
+            ? static_cast<size_t>(max(count_it->second.AsInt(), 0)) : numeric_limits<size_t>::max();
+        const double radius = radius_it != request.end()
+            ? radius_it->second.AsDouble() : numeric_limits<double>::infinity();
+
+        writer.StartDict()
+            .Key("request_id"sv).Value(id)
+            .Key("stops"sv).StartArray();
+
+        for (const auto& [name, distance] : FindNearbyStops(point, count, radius)) {
+            writer.StartDict()
+                .Key("distance"sv).Value(distance)
+                .Key("name"sv).Value(name)
                 .EndDict();
-        } else {
-            throw invalid_argument("wrong query to catalogue"s);
         }
+
+        writer.EndArray().EndDict();
+    } else {
+        throw invalid_argument("wrong query to catalogue"s);
     }
+}
 
-    return json::Document(arr_ctx.EndArray().Build());
+void RequestHandler::WriteRides(const Route& rides, json::Writer& writer) const {
+    const int wait_time = routing_settings_->bus_wait_time;
+
+    for (const auto& edge : rides) {
+        writer.StartDict()
+            .Key("stop_name"sv).Value(edge.stop_from)
+            .Key("time"sv).Value(wait_time)
+            .Key("type"sv).Value("Wait"sv)
+            .EndDict();
+
+        writer.StartDict()
+            .Key("bus"sv).Value(edge.bus_name)
+            .Key("span_count"sv).Value(edge.span_count)
+            .Key("time"sv).Value(edge.total_time - wait_time)
+            .Key("type"sv).Value("Bus"sv)
+            .EndDict();
+    }
 }
 
 void RequestHandler::Serialize(serialize::Settings settings, 
     optional<renderer::RenderSettings> render_settings,
     optional<route::RouteSettings> route_settings) {
-    
+
+    profile::ScopedTimer timer("RequestHandler::Serialize"sv);
+    report_stats_ = settings.report;
+
+    const StopIndex stop_index = StopIndex::Build(db_);
+
+    string_view map_svg;
+    if (settings.prerender_map && render_settings) {
+        SetRenderer(*render_settings);
+        map_svg = GetMapSvg();
+    }
+
+    if (settings.format == serialize::BaseFormat::MAPPED) {
+        if (route_settings) {
+            router_ = std::make_unique<route::TransportRouter>(db_, route_settings.value());
+            router_->SetThreadsCount(settings.threads);
+            router_->SetReportStats(settings.report);
+
+            // В отображаемый файл из данных режима попадает только матрица ALL_PAIRS,
+            // остальные режимы ищут маршрут алгоритмом Дейкстры по графу из файла
+            if (settings.router_storage == serialize::RouterStorage::FULL
+                && route_settings->mode == route::RouterMode::ALL_PAIRS) {
+                router_->InitRouter();
+            } else if (settings.router_storage != serialize::RouterStorage::SETTINGS) {
+                router_->BuildGraph();
+            }
+        }
+
+        serialize::MappedBase::Save(settings.file, db_, render_settings, router_.get(), stop_index, map_svg);
+    } else {
+        SerializeProtobuf(settings, move(render_settings), move(route_settings), stop_index, map_svg);
+    }
+
+    profile::Count("base_file.bytes"sv, filesystem::file_size(settings.file));
+
+    if (settings.report) {
+        cerr << "Base file size: "s << filesystem::file_size(settings.file) << " bytes"s << endl;
+    }
+}
+
+void RequestHandler::SerializeProtobuf(const serialize::Settings& settings,
+    optional<renderer::RenderSettings> render_settings,
+    optional<route::RouteSettings> route_settings,
+    const StopIndex& stop_index,
+    string_view map_svg) {
+
     serialize::Serializator serializator(settings);
 
     serializator.SaveTransportCatalogue(db_);
+    serializator.SaveStopIndex(stop_index);
 
     if (render_settings) {
        serializator.SaveRenderSettings(move(render_settings.value())); 
     }
 
+    if (!map_svg.empty()) {
+        serializator.SaveMapSvg(string(map_svg));
+    }
+
     if (route_settings) {
         router_ = std::make_unique<route::TransportRouter>(db_, route_settings.value());
-        router_->InitRouter();
+        router_->SetThreadsCount(settings.threads);
+        router_->SetReportStats(settings.report);
+
+        if (settings.router_storage == serialize::RouterStorage::FULL) {
+            router_->InitRouter();
+        } else if (settings.router_storage == serialize::RouterStorage::GRAPH) {
+            router_->BuildGraph();
+        }
+
         serializator.SaveTransportRouter(*router_.get());
     }
 
@@ -245,18 +952,53 @@ void RequestHandler::Serialize(serialize::Settings settings,
 }
 
 void RequestHandler::Deserialize(serialize::Settings settings) {
-    serialize::Serializator serializator(settings);
-    
-    optional<renderer::RenderSettings> render_settings;
+    profile::ScopedTimer timer("RequestHandler::Deserialize"sv);
+    const auto start = chrono::steady_clock::now();
+
+    report_stats_ = settings.report;
+    threads_count_ = settings.threads;
+
+    if (settings.format == serialize::BaseFormat::MAPPED) {
+        // Справочник и отрисовщик заполняются только при первом запросе, которому они нужны
+        mapped_base_ = make_unique<serialize::MappedBase>(settings.file);
+        routing_settings_ = mapped_base_->GetRouteSettings();
+        mapped_render_settings_ = mapped_base_->GetRenderSettings();
+        map_svg_ = mapped_base_->GetMapSvg();
+    } else {
+        serialize::Serializator serializator(settings);
 
-    serializator.Deserialize(const_cast<TransportCatalogue&>(db_), render_settings, router_);
+        optional<renderer::RenderSettings> render_settings;
+        optional<string> map_svg;
+
+        serializator.Deserialize(const_cast<TransportCatalogue&>(db_), render_settings, router_, map_svg,
+            stop_index_);
+
+        if (router_) {
+            routing_settings_ = router_->GetSettings();
+        }
+
+        if (render_settings) {
+            SetRenderer(render_settings.value());
+        }
+
+        if (map_svg) {
+            map_svg_storage_ = move(*map_svg);
+            map_svg_ = map_svg_storage_;
+        }
+    }
 
     if (router_) {
-        routing_settings_ = router_->GetSettings();
+        router_->SetThreadsCount(settings.threads);
+        router_->SetReportStats(settings.report);
     }
 
-    if (render_settings) {
-        SetRenderer(render_settings.value());
+    if (report_stats_) {
+        const auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start);
+        cerr << "Base loaded in "s << elapsed.count() << " ms"s << endl;
+
+        if (map_svg_) {
+            cerr << "Prerendered map: "s << map_svg_->size() << " bytes"s << endl;
+        }
     }
 }
 
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <variant>
 
 #include "json_builder.h"
+#include "latency_histogram.h"
 #include "map_renderer.h"
+#include "mapped_base.h"
 #include "serialization.h"
+#include "stop_index.h"
+#include "thread_pool.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
@@ -14,16 +23,69 @@ class RequestHandler {
 public:
     using Route = route::TransportRouter::TransportRoute;
 
+    // Конец маршрута: остановка по названию или точка на карте
+    using RoutePoint = std::variant<std::string, geo::Coordinates>;
+
+    // Пеший участок между точкой и остановкой stop_name; без остановки —
+    // весь путь от точки до точки пешком
+    struct WalkLeg {
+        std::string_view stop_name;
+        double distance = 0;
+        double time = 0;
+    };
+
+    struct PointsRoute {
+        std::optional<WalkLeg> walk_to_stop;
+        Route rides;
+        std::optional<WalkLeg> walk_from_stop;
+        double total_time = 0;
+    };
+
     RequestHandler(const TransportCatalogue& db);
 
     std::optional<BusStat> GetBusStat(const std::string& bus_name) const;
 
-    const std::set<std::string_view>* GetBusesThroughStop(const std::string& stop_name) const;
+    std::optional<std::vector<std::string_view>> GetBusesThroughStop(const std::string& stop_name) const;
+
+    // Не больше count ближайших к point остановок в радиусе max_distance метров:
+    // названия и расстояния по возрастанию расстояния
+    std::vector<std::pair<std::string_view, double>> FindNearbyStops(geo::Coordinates point,
+        size_t count, double max_distance) const;
 
     const svg::Document& RenderMap() const;
     std::optional<RequestHandler::Route> BuildRoute(const std::string &from, const std::string &to) const;
-
-    json::Document GetJsonResponse(const json::Array& requests) const;
+    using RouteMatrixRow = std::vector<std::optional<route::TransportRouter::RouteTime>>;
+
+    // Матрица маршрутов from × to: по одному поиску на каждую остановку from,
+    // строки считаются параллельно. Для неизвестной остановки строка или столбец пустые
+    std::vector<RouteMatrixRow> BuildRouteMatrix(const std::vector<std::string_view>& from,
+        const std::vector<std::string_view>& to, bool with_rides) const;
+
+    // Остановки, до которых от from можно доехать не дольше чем за max_time минут:
+    // названия и время по возрастанию времени. nullopt — нет остановки или настроек маршрутов
+    std::optional<std::vector<std::pair<std::string_view, double>>> FindReachableStops(std::string_view from,
+        double max_time) const;
+    // Слой для наложения на карту из ответа Map; nullopt — нет настроек отрисовки
+    std::optional<std::string> RenderIsochrone(const std::vector<std::pair<std::string_view, double>>& stops,
+        double max_time) const;
+
+    // Остановки посадки и высадки выбираются по индексу остановок в пределах
+    // max_walk_distance от точек, дальше — один поиск от всех них сразу
+    std::optional<PointsRoute> BuildRoute(const RoutePoint& from, const RoutePoint& to) const;
+
+    // Пишет ответы на stat_requests в out по мере их вычисления, не собирая документ.
+    // При нескольких потоках (serialization_settings.threads) запросы считаются
+    // параллельно пачками, ответы выводятся в порядке запросов
+    void PrintJsonResponse(const json::Array& requests, std::ostream& out) const;
+
+    // Запись времени ответа на каждый stat_request в гистограмму его типа;
+    // включается до обработки запросов
+    void SetLatencyStats(bool enabled);
+    // Словарь {тип: {"count", "max_ms", "mean_ms", "p50_ms", "p999_ms", "p99_ms"}}
+    // по типам, для которых есть записи; with_buckets добавляет непустые корзины
+    void WriteLatencyStats(json::Writer& writer, bool with_buckets) const;
+    // Та же сводка таблицей
+    void PrintLatencySummary(std::ostream& out) const;
 
 
     bool SetRouter() const;
@@ -37,12 +99,71 @@ public:
     void Deserialize(serialize::Settings settings);
 
 private:
+    // Типы запросов, для которых собираются задержки, по одной гистограмме на тип в latencies_
+    static constexpr std::array<std::string_view, 7> LATENCY_TYPES = {
+        "Bus", "Stop", "Map", "Route", "RouteMatrix", "Nearby", "Isochrone"};
+
+    void SerializeProtobuf(const serialize::Settings& settings,
+        std::optional<renderer::RenderSettings> render_settings,
+        std::optional<route::RouteSettings> route_settings,
+        const StopIndex& stop_index,
+        std::string_view map_svg);
+
+    void WriteResponse(const json::Dict& request, json::Writer& writer) const;
+    // Гистограмма типа запроса; nullptr, если запись выключена или тип не учитывается
+    stats::LatencyHistogram* GetLatencyHistogram(std::string_view type) const;
+    void WriteResponsesParallel(const json::Array& requests, std::streamsize precision,
+        json::Writer& writer) const;
+    // Пары Wait/Bus ответа на Route
+    void WriteRides(const Route& rides, json::Writer& writer) const;
+
+    concurrency::ThreadPool& GetPool() const;
+
+    // Ленивая подготовка маршрутизатора и карты; безопасны при вызове из нескольких потоков
+    bool PrepareRouter() const;
+    // То же, но без данных режима: хватает поиска Дейкстрой по графу
+    bool PrepareDijkstraRouter() const;
+    // SVG карты считается один раз (или берётся из базы) и переиспользуется всеми запросами Map
+    std::string_view GetMapSvg() const;
+    // Индекс из базы; если его нет, строится по справочнику при первом запросе Nearby
+    const StopIndex& GetStopIndex() const;
+    std::optional<StopId> FindStopId(std::string_view name) const;
+    std::string_view GetStopName(StopId id) const;
+    // Кандидаты для начала или конца маршрута и расстояния до них в метрах
+    std::vector<StopIndex::Found> FindWalkStops(const RoutePoint& point) const;
+    std::optional<route::TransportRouter::WalkRoute> BuildWalkRoute(const std::vector<route::WalkStop>& sources,
+        const std::vector<route::WalkStop>& targets) const;
+
+    void InitRenderer(renderer::RenderSettings render_settings) const;
+    // Для базы формата MAPPED переносит данные в справочник там, где без него не обойтись
+    void FillCatalogueFromMappedBase() const;
+
     const TransportCatalogue& db_;
 
     mutable std::unique_ptr<route::TransportRouter> router_;
-    std::unique_ptr<renderer::MapRenderer> renderer_;
+    mutable std::unique_ptr<renderer::MapRenderer> renderer_;
+
+    std::unique_ptr<serialize::MappedBase> mapped_base_;
+    std::optional<renderer::RenderSettings> mapped_render_settings_;
+    mutable bool is_catalogue_filled_ = false;
+
+    mutable std::optional<std::string_view> map_svg_;
+    mutable std::string map_svg_storage_;
+
+    mutable std::optional<StopIndex> stop_index_;
+
+    mutable std::mutex router_mutex_;
+    mutable std::mutex map_mutex_;
+    mutable std::mutex catalogue_mutex_;
+    mutable std::mutex stop_index_mutex_;
+    mutable std::unique_ptr<concurrency::ThreadPool> pool_;
+    mutable std::once_flag pool_once_;
 
     std::optional<route::RouteSettings> routing_settings_;
+    bool report_stats_ = false;
+    bool record_latency_ = false;
+    mutable std::array<stats::LatencyHistogram, LATENCY_TYPES.size()> latencies_;
+    size_t threads_count_ = 1;
 };
 
 
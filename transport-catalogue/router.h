@@ -1,11 +1,13 @@
 #pragma once
 
 #include "graph.h"
+#include "thread_pool.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
@@ -15,13 +17,24 @@
 
 namespace graph {
 
+// Router хранит веса матрицы в виде float, поэтому для Weight нужно уметь
+// получить вес числом. Для пользовательских типов шаблон специализируется
+template <typename Weight>
+struct WeightTraits {
+    static double ToScalar(const Weight& weight) {
+        return static_cast<double>(weight);
+    }
+};
+
 template <typename Weight>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    explicit Router(const Graph& graph, bool initialize = true);
+    // threads_count задаёт число потоков для построения матрицы (0 — по числу ядер);
+    // результат не зависит от числа потоков
+    explicit Router(const Graph& graph, bool initialize = true, size_t threads_count = 1);
 
     struct RouteInfo {
         Weight weight;
@@ -30,55 +43,127 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    // Ячейка матрицы занимает 8 байт: недостижимость кодируется бесконечным
+    // весом, отсутствие предыдущего ребра — значением NO_EDGE
     struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+        float weight;
+        uint32_t prev_edge;
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    static_assert(sizeof(RouteInternalData) == 8);
+
+    static constexpr uint32_t NO_EDGE = std::numeric_limits<uint32_t>::max();
+    static constexpr float UNREACHABLE = std::numeric_limits<float>::infinity();
+
+    // Матрица V×V, хранящаяся построчно: маршрут from -> to лежит в ячейке from * V + to
+    using RoutesInternalData = std::vector<RouteInternalData>;
 
 private:
+    // Сторона квадратного блока: три блока 64×64 по 8 байт помещаются в L2
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    RouteInternalData& GetCell(VertexId from, VertexId to) {
+        return routes_internal_data_[from * vertex_count_ + to];
+    }
+
+    const RouteInternalData& GetCell(VertexId from, VertexId to) const {
+        return routes_internal_data_[from * vertex_count_ + to];
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        if (graph.GetEdgeCount() >= NO_EDGE) {
+            throw std::length_error("Too many edges for the routes matrix");
+        }
+
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            GetCell(vertex, vertex) = RouteInternalData{0.f, NO_EDGE};
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
                 if (edge.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const auto weight = static_cast<float>(WeightTraits<Weight>::ToScalar(edge.weight));
+                auto& route_internal_data = GetCell(vertex, edge.to);
+                if (route_internal_data.weight > weight) {
+                    route_internal_data = RouteInternalData{weight, static_cast<uint32_t>(edge_id)};
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Релаксирует блок строк [from_begin, from_end) × столбцов [to_begin, to_end)
+    // через вершины [through_begin, through_end)
+    void RelaxBlock(VertexId from_begin, VertexId from_end, VertexId to_begin, VertexId to_end,
+                    VertexId through_begin, VertexId through_end) {
+        for (VertexId vertex_through = through_begin; vertex_through < through_end; ++vertex_through) {
+            const RouteInternalData* row_through = &GetCell(vertex_through, 0);
+
+            for (VertexId vertex_from = from_begin; vertex_from < from_end; ++vertex_from) {
+                const RouteInternalData route_from = GetCell(vertex_from, vertex_through);
+                if (route_from.weight == UNREACHABLE) {
+                    continue;
+                }
+
+                RouteInternalData* row_from = &GetCell(vertex_from, 0);
+                for (VertexId vertex_to = to_begin; vertex_to < to_end; ++vertex_to) {
+                    const RouteInternalData& route_to = row_through[vertex_to];
+                    const float candidate_weight = route_from.weight + route_to.weight;
+                    if (candidate_weight < row_from[vertex_to].weight) {
+                        row_from[vertex_to] = {candidate_weight,
+                                               route_to.prev_edge != NO_EDGE ? route_to.prev_edge
+                                                                             : route_from.prev_edge};
+                    }
+                }
+            }
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+    // Блочный Флойд–Уоршелл: на шаге k сначала диагональный блок (k, k),
+    // затем блоки строки и столбца k, затем все остальные. Внутри второй и третьей
+    // фаз блоки друг от друга не зависят и считаются параллельно; каждую ячейку
+    // пересчитывает ровно одна задача в прежнем порядке, поэтому результат
+    // побитово совпадает с однопоточным
+    void RelaxRoutesInternalData(concurrency::ThreadPool& pool) {
+        const size_t blocks_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        auto block_begin = [](size_t block) {
+            return block * BLOCK_SIZE;
+        };
+        auto block_end = [this](size_t block) {
+            return std::min((block + 1) * BLOCK_SIZE, vertex_count_);
+        };
+
+        for (size_t k = 0; k < blocks_count; ++k) {
+            const VertexId through_begin = block_begin(k);
+            const VertexId through_end = block_end(k);
+
+            RelaxBlock(through_begin, through_end, through_begin, through_end, through_begin, through_end);
+
+            pool.ParallelFor(blocks_count, [&](size_t block) {
+                if (block != k) {
+                    RelaxBlock(through_begin, through_end, block_begin(block), block_end(block),
+                               through_begin, through_end);
+                    RelaxBlock(block_begin(block), block_end(block), through_begin, through_end,
+                               through_begin, through_end);
+                }
+            });
+
+            pool.ParallelFor(blocks_count, [&](size_t block_from) {
+                if (block_from == k) {
+                    return;
+                }
+                for (size_t block_to = 0; block_to < blocks_count; ++block_to) {
+                    if (block_to != k) {
+                        RelaxBlock(block_begin(block_from), block_end(block_from),
+                                   block_begin(block_to), block_end(block_to),
+                                   through_begin, through_end);
                     }
                 }
-            }
+            });
         }
     }
 
     static constexpr Weight ZERO_WEIGHT{};
     const Graph& graph_;
+    size_t vertex_count_;
     RoutesInternalData routes_internal_data_;
 public:
     RoutesInternalData& GetRoutesInternalData() {
@@ -90,40 +175,47 @@ public:
 };
 
 template <typename Weight>
-Router<Weight>::Router(const Graph& graph, bool initialize)
+Router<Weight>::Router(const Graph& graph, bool initialize, size_t threads_count)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , vertex_count_(graph.GetVertexCount())
+    , routes_internal_data_(vertex_count_ * vertex_count_, RouteInternalData{UNREACHABLE, NO_EDGE})
 {
     if (initialize) {
         InitializeRoutesInternalData(graph);
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
-        }
+        concurrency::ThreadPool pool(threads_count);
+        RelaxRoutesInternalData(pool);
     }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex is out of range");
+    }
+
+    const auto& route_internal_data = GetCell(from, to);
+    if (route_internal_data.weight == UNREACHABLE) {
         return std::nullopt;
     }
 
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (uint32_t edge_id = route_internal_data.prev_edge;
+         edge_id != NO_EDGE;
+         edge_id = GetCell(from, graph_.GetEdge(edge_id).from).prev_edge)
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
-    
+
+    // В матрице вес хранится во float, точный вес маршрута собирается из рёбер
+    Weight weight = ZERO_WEIGHT;
+    for (const EdgeId edge_id : edges) {
+        weight = weight + graph_.GetEdge(edge_id).weight;
+    }
+
     return RouteInfo{weight, std::move(edges)};
 }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
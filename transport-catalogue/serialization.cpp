@@ -1,6 +1,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "profile.h"
 #include "serialization.h"
 
 namespace serialize {
@@ -12,31 +13,66 @@ void Serializator::SaveTransportCatalogue(const TransportCatalogue& catalogue) {
 }
 
 void Serializator::SaveRenderSettings(transport::renderer::RenderSettings render_settings) {
-    auto proto_settings = proto_catalogue_.mutable_render_settings();
+    *proto_catalogue_.mutable_render_settings() = MakeProtoRenderSettings(render_settings);
+}
+
+void Serializator::SaveMapSvg(std::string map_svg) {
+    proto_catalogue_.set_map_svg(std::move(map_svg));
+}
+
+// Координаты остановок в файл не дублируются, при загрузке они берутся из справочника
+void Serializator::SaveStopIndex(const transport::StopIndex& stop_index) {
+    auto& proto_index = *proto_catalogue_.mutable_catalogue()->mutable_stop_index();
+    const auto& grid = stop_index.GetGrid();
+
+    proto_index.set_min_lat(grid.min_lat);
+    proto_index.set_min_lng(grid.min_lng);
+    proto_index.set_cell_lat(grid.cell_lat);
+    proto_index.set_cell_lng(grid.cell_lng);
+    proto_index.set_rows(grid.rows);
+    proto_index.set_cols(grid.cols);
+
+    for (uint32_t offset : stop_index.GetCellOffsets()) {
+        proto_index.add_cell_offset(offset);
+    }
+
+    for (const auto& entry : stop_index.GetEntries()) {
+        proto_index.add_stop_id(entry.stop_id);
+    }
+}
+
+proto_map_renderer::RenderSettings Serializator::MakeProtoRenderSettings(
+    const transport::renderer::RenderSettings& render_settings) {
+    
+    proto_map_renderer::RenderSettings proto_settings;
 
-    proto_settings->set_width(render_settings.width);
-    proto_settings->set_height(render_settings.height);
+    proto_settings.set_width(render_settings.width);
+    proto_settings.set_height(render_settings.height);
 
-    proto_settings->set_padding(render_settings.padding);
+    proto_settings.set_padding(render_settings.padding);
 
-    proto_settings->set_line_width(render_settings.line_width);
-    proto_settings->set_stop_radius(render_settings.stop_radius);
+    proto_settings.set_line_width(render_settings.line_width);
+    proto_settings.set_stop_radius(render_settings.stop_radius);
 
-    proto_settings->set_bus_label_font_size(render_settings.bus_label_font_size);
-    *proto_settings->mutable_bus_label_offset() = MakeProtoPoint(render_settings.bus_label_offset);
+    proto_settings.set_bus_label_font_size(render_settings.bus_label_font_size);
+    *proto_settings.mutable_bus_label_offset() = MakeProtoPoint(render_settings.bus_label_offset);
 
-    proto_settings->set_stop_label_font_size(render_settings.stop_label_font_size);
-    *proto_settings->mutable_stop_label_offset() = MakeProtoPoint(render_settings.stop_label_offset);
+    proto_settings.set_stop_label_font_size(render_settings.stop_label_font_size);
+    *proto_settings.mutable_stop_label_offset() = MakeProtoPoint(render_settings.stop_label_offset);
 
-    *proto_settings->mutable_underlayer_color() = MakeProtoColor(render_settings.underlayer_color);
-    proto_settings->set_underlayer_width(render_settings.underlayer_width);
+    *proto_settings.mutable_underlayer_color() = MakeProtoColor(render_settings.underlayer_color);
+    proto_settings.set_underlayer_width(render_settings.underlayer_width);
 
     for (auto &color : render_settings.color_palette) {
-        *proto_settings->add_color_palette() = MakeProtoColor(color);
+        *proto_settings.add_color_palette() = MakeProtoColor(color);
     }
+
+    return proto_settings;
 }
 
 bool Serializator::Serialize() {
+    profile::ScopedTimer timer("Serializator::Serialize");
+
     std::ofstream out_file(settings_.file, std::ios::binary);
     
     if (!out_file.is_open ()) {
@@ -50,8 +86,11 @@ bool Serializator::Serialize() {
 
 bool Serializator::Deserialize(TransportCatalogue& catalogue, 
     std::optional<transport::renderer::RenderSettings>& result_settings,
-    std::unique_ptr<route::TransportRouter>& router) {
-    
+    std::unique_ptr<route::TransportRouter>& router,
+    std::optional<std::string>& map_svg,
+    std::optional<transport::StopIndex>& stop_index) {
+
+    profile::ScopedTimer timer("Serializator::Deserialize");
     std::ifstream in_file(settings_.file, std::ios::binary);
     
     if (!in_file.is_open() || !proto_catalogue_.ParseFromIstream(&in_file)) {
@@ -61,56 +100,47 @@ bool Serializator::Deserialize(TransportCatalogue& catalogue,
     LoadStops(catalogue);
     LoadDistances(catalogue);
     LoadBuses(catalogue);
+    LoadStopIndex(catalogue, stop_index);
 
     LoadRenderSettings(result_settings);
 
     LoadTransportRouter(catalogue, router);
 
+    if (!proto_catalogue_.map_svg().empty()) {
+        map_svg = std::move(*proto_catalogue_.mutable_map_svg());
+    }
+
     return true;
 }
 
+// Остановки и автобусы пишутся в порядке идентификаторов, поэтому
+// при загрузке они получают те же номера, что были при сохранении
 void Serializator::SaveStops(const TransportCatalogue& catalogue) {
-    auto comp = [] (const transport::Stop* a, const transport::Stop* b) {
-        return a->id < b->id;
-    };
-
-    std::set<const transport::Stop*, decltype(comp)> stops(comp);
-
-    for (const auto& [stop_name, stop] : catalogue.GetStops()) {
-              
-        stops.insert(stop);
-    }
-    
-    
-    for (auto stop : stops) {
+    for (const auto& stop : catalogue.GetStops()) {
         proto_catalogue::Stop proto_stop;
-        proto_stop.set_id(stop->id);
-        proto_stop.set_name(stop->name);
-        *proto_stop.mutable_coordinates() = MakeProtoCoordinates(stop->coordinates);
+        proto_stop.set_id(stop.id);
+        proto_stop.set_name(stop.name);
+        *proto_stop.mutable_coordinates() = MakeProtoCoordinates(stop.coordinates);
         *proto_catalogue_.mutable_catalogue()->add_stop() = std::move(proto_stop);
     }
 }
 
 void Serializator::SaveBuses(const TransportCatalogue &catalogue) {
-    auto& buses = catalogue.GetBuses();
-    uint32_t id = 0;
-    
-    for (auto [name, bus] : buses) {
+    for (const auto& bus : catalogue.GetBuses()) {
         proto_catalogue::Bus proto_bus;
-        proto_bus.set_id(id);
-        proto_bus.set_name(bus->name);
-        proto_bus.set_circular(bus->circular);
-        SaveBusStops(*bus, proto_bus, catalogue);
-        bus_id_by_name_.insert({name, id++});
+        proto_bus.set_id(bus.id);
+        proto_bus.set_name(bus.name);
+        proto_bus.set_circular(bus.circular);
+        SaveBusStops(bus, proto_bus);
+        bus_id_by_name_.insert({bus.name, bus.id});
         *proto_catalogue_.mutable_catalogue()->add_bus() = std::move(proto_bus);
     }
 }
 
-void Serializator::SaveBusStops(const transport::Bus& bus,
-    proto_catalogue::Bus& proto_bus, const TransportCatalogue& catalogue) {
+void Serializator::SaveBusStops(const transport::Bus& bus, proto_catalogue::Bus& proto_bus) {
     
     for (auto stop : bus.bus_stops) {
-        proto_bus.add_stop_id(catalogue.GetStopId(stop->name));
+        proto_bus.add_stop_id(stop->id);
     }
 }
 
@@ -120,8 +150,8 @@ void Serializator::SaveDistances(const TransportCatalogue& catalogue) {
     for (auto &[from_to, length] : distances) {
         proto_catalogue::Distance proto_distance;
         
-        proto_distance.set_stop_id_from(catalogue.GetStopId(from_to.first->name));
-        proto_distance.set_stop_id_to(catalogue.GetStopId(from_to.second->name));
+        proto_distance.set_stop_id_from(from_to.first);
+        proto_distance.set_stop_id_to(from_to.second);
         proto_distance.set_length(length);
         
         *proto_catalogue_.mutable_catalogue()->add_distance() = std::move(proto_distance);
@@ -130,8 +160,23 @@ void Serializator::SaveDistances(const TransportCatalogue& catalogue) {
 
 void Serializator::SaveTransportRouter(const route::TransportRouter& router) {
     SaveTransportRouterSettings(router.GetSettings());
+
+    if (settings_.router_storage == RouterStorage::SETTINGS) {
+        return;
+    }
+
     SaveGraph(router.GetGraph());
-    SaveRouter(router.GetRouter());
+    SaveVertexStopIds(router.GetVertexStopIds());
+
+    if (settings_.router_storage != RouterStorage::FULL) {
+        return;
+    }
+
+    if (router.GetSettings().mode == route::RouterMode::ALL_PAIRS) {
+        SaveRouter(router.GetRouter());
+    } else if (router.GetSettings().mode == route::RouterMode::CONTRACTION_HIERARCHY) {
+        SaveContractionHierarchy(*router.GetContractionHierarchy());
+    }
 }
 
 void Serializator::SaveTransportRouterSettings(const route::RouteSettings& routing_settings) {
@@ -139,6 +184,10 @@ void Serializator::SaveTransportRouterSettings(const route::RouteSettings& routi
 
     proto_settings->set_wait_time(routing_settings.bus_wait_time);
     proto_settings->set_velocity(routing_settings.bus_velocity);
+    proto_settings->set_mode(static_cast<proto_transport_router::RouterMode>(routing_settings.mode));
+    proto_settings->set_graph_model(static_cast<proto_transport_router::GraphModel>(routing_settings.graph_model));
+    proto_settings->set_walk_velocity(routing_settings.walk_velocity);
+    proto_settings->set_max_walk_distance(routing_settings.max_walk_distance);
 }
 
 void Serializator::SaveGraph(const route::TransportRouter::Graph &graph) {
@@ -163,28 +212,42 @@ void Serializator::SaveGraph(const route::TransportRouter::Graph &graph) {
 
 }
 
+void Serializator::SaveVertexStopIds(const std::vector<int>& vertex_stop_ids) {
+    auto proto_router = proto_catalogue_.mutable_router();
+
+    for (auto stop_id : vertex_stop_ids) {
+        proto_router->add_vertex_stop_id(stop_id);
+    }
+}
+
 void Serializator::SaveRouter(const std::unique_ptr<route::TransportRouter::Router>& router) {
     auto proto_router = proto_catalogue_.mutable_router()->mutable_router();
+    const auto& routes_internal_data = router->GetRoutesInternalData();
 
-    for (const auto& data : router->GetRoutesInternalData()) {
-        proto_graph::RoutesInternalData proto_data;
-        
-        for (const auto &internal : data) {
-            proto_graph::OptionalRouteInternalData proto_internal;
-            
-            if (internal.has_value()) {
-                auto& value = internal.value();
-                auto proto_value = proto_internal.mutable_route_internal_data();
-                
-                proto_value->set_total_time(value.weight.total_time);
-                
-                if (value.prev_edge.has_value()) {
-                    proto_value->set_prev_edge(value.prev_edge.value());
-                }
-            }
-            *proto_data.add_routes_internal_data() = std::move(proto_internal);
-        }
-        *proto_router->add_routes_internal_data() = std::move(proto_data);
+    proto_router->mutable_total_time()->Reserve(routes_internal_data.size());
+    proto_router->mutable_prev_edge()->Reserve(routes_internal_data.size());
+
+    for (const auto& data : routes_internal_data) {
+        proto_router->add_total_time(data.weight);
+        proto_router->add_prev_edge(data.prev_edge);
+    }
+}
+
+void Serializator::SaveContractionHierarchy(const route::TransportRouter::ContractionHierarchy& hierarchy) {
+    auto proto_hierarchy = proto_catalogue_.mutable_router()->mutable_contraction_hierarchy();
+
+    for (auto rank : hierarchy.GetRanks()) {
+        proto_hierarchy->add_rank(rank);
+    }
+
+    for (const auto& shortcut : hierarchy.GetShortcuts()) {
+        auto proto_shortcut = proto_hierarchy->add_shortcuts();
+
+        proto_shortcut->set_from(shortcut.from);
+        proto_shortcut->set_to(shortcut.to);
+        proto_shortcut->set_total_time(shortcut.weight.total_time);
+        proto_shortcut->set_first_edge(shortcut.first);
+        proto_shortcut->set_second_edge(shortcut.second);
     }
 }
 
@@ -292,9 +355,7 @@ route::RouteWeight Serializator::MakeWeight(const TransportCatalogue& catalogue,
     
     route::RouteWeight weight;
 
-    auto route_name = catalogue.GetBuses().at(bus_name_by_id_.at(proto_weight.bus_id()));
-    
-    weight.bus_name = route_name->name;
+    weight.bus_name = catalogue.GetBusById(proto_weight.bus_id()).name;
     weight.span_count = proto_weight.span_count();
     weight.total_time = proto_weight.total_time();
     
@@ -319,44 +380,57 @@ void Serializator::LoadBuses(TransportCatalogue &catalogue) {
     for (int i = 0; i < buses_count; ++i) {
         auto& proto_bus = proto_catalogue_.catalogue().bus(i);
         LoadBus(catalogue, proto_bus);
-        bus_name_by_id_.insert({proto_bus.id(), proto_bus.name()});
     }
 }
 
 void Serializator::LoadBus(TransportCatalogue& catalogue,
     const proto_catalogue::Bus& proto_bus) const {
     
-    auto stops_count = proto_bus.stop_id_size();
-    
-    std::vector<std::string> stops;
-    
-    stops.reserve(stops_count);
-    
-    for(int i = 0; i < stops_count; ++i) {
-        auto stop_name = catalogue.GetStopNameById(proto_bus.stop_id(i));
-        stops.push_back(stop_name);
-    }
+    std::vector<transport::StopId> stops(proto_bus.stop_id().begin(), proto_bus.stop_id().end());
 
-    catalogue.AddBus({proto_bus.name(), move(stops), proto_bus.circular()});
+    catalogue.AddBus(proto_bus.name(), stops, proto_bus.circular());
 }
 
 void Serializator::LoadDistances(TransportCatalogue& catalogue) const {
-    std::unordered_map<std::string, std::unordered_map<std::string, int>> d_map;
+    for (const auto& proto_distance : proto_catalogue_.catalogue().distance()) {
+        catalogue.AddDistance(proto_distance.stop_id_from(), proto_distance.stop_id_to(),
+            proto_distance.length());
+    }
+}
 
-    auto distances_count = proto_catalogue_.catalogue().distance_size();
-    
-    for (int i = 0; i < distances_count; ++i) {
-        auto& proto_distance = proto_catalogue_.catalogue().distance(i);
-        
-        auto stop_from = catalogue.GetStopNameById(proto_distance.stop_id_from());
-        auto stop_to = catalogue.GetStopNameById(proto_distance.stop_id_to());
+void Serializator::LoadStopIndex(const TransportCatalogue& catalogue,
+    std::optional<transport::StopIndex>& stop_index) const {
 
-        d_map[stop_from][stop_to] = proto_distance.length();
+    const auto& proto_index = proto_catalogue_.catalogue().stop_index();
+    const size_t cells_count = static_cast<size_t>(proto_index.rows()) * proto_index.cols();
+
+    // В базах, собранных до появления индекса, его нет: построим заново
+    if (!proto_catalogue_.catalogue().has_stop_index()
+        || static_cast<size_t>(proto_index.cell_offset_size()) != cells_count + 1
+        || proto_index.cell_offset(cells_count) != static_cast<uint32_t>(proto_index.stop_id_size())) {
+
+        stop_index = transport::StopIndex::Build(catalogue);
+        return;
     }
 
-    for (auto& [from, mp_to] : d_map) {
-        catalogue.AddDistances({move(from), move(mp_to)});
+    transport::StopIndex::Grid grid;
+    grid.min_lat = proto_index.min_lat();
+    grid.min_lng = proto_index.min_lng();
+    grid.cell_lat = proto_index.cell_lat();
+    grid.cell_lng = proto_index.cell_lng();
+    grid.rows = proto_index.rows();
+    grid.cols = proto_index.cols();
+
+    std::vector<uint32_t> cell_offsets(proto_index.cell_offset().begin(), proto_index.cell_offset().end());
+    std::vector<transport::StopIndex::Entry> entries;
+    entries.reserve(proto_index.stop_id_size());
+
+    for (uint32_t stop_id : proto_index.stop_id()) {
+        const auto& coordinates = catalogue.GetStopById(stop_id).coordinates;
+        entries.push_back({coordinates.lat, coordinates.lng, stop_id});
     }
+
+    stop_index.emplace(grid, std::move(cell_offsets), std::move(entries));
 }
 
 void Serializator::LoadRenderSettings(std::optional<transport::renderer::RenderSettings>& result_settings) const {
@@ -364,7 +438,11 @@ void Serializator::LoadRenderSettings(std::optional<transport::renderer::RenderS
         return;
     }
 
-    auto& proto_settings = proto_catalogue_.render_settings();
+    result_settings = MakeRenderSettings(proto_catalogue_.render_settings());
+}
+
+transport::renderer::RenderSettings Serializator::MakeRenderSettings(
+    const proto_map_renderer::RenderSettings& proto_settings) {
 
     transport::renderer::RenderSettings settings;
 
@@ -394,7 +472,7 @@ void Serializator::LoadRenderSettings(std::optional<transport::renderer::RenderS
         settings.color_palette.push_back(MakeColor(proto_settings.color_palette(i)));
     }
 
-    result_settings = settings;
+    return settings;
 }
 
 void Serializator::LoadTransportRouter(const TransportCatalogue& catalogue,
@@ -409,20 +487,72 @@ void Serializator::LoadTransportRouter(const TransportCatalogue& catalogue,
 
     transport_router = std::make_unique<route::TransportRouter>(catalogue, routing_settings);
 
+    // Всё, чего нет в файле, маршрутизатор достроит при первом запросе Route
+    auto& proto_router = proto_catalogue_.router();
+
+    if (!proto_router.has_graph()) {
+        return;
+    }
+
     LoadGraph(catalogue, transport_router->GetGraph());
+    LoadVertexStopIds(transport_router->GetVertexStopIds());
+    transport_router->InternalGraphInit();
 
-    transport_router->GetRouter() =
-        std::make_unique<route::TransportRouter::Router>(transport_router->GetGraph(), false);
-    LoadRouter(catalogue, transport_router->GetRouter());
+    if (routing_settings.mode == route::RouterMode::ALL_PAIRS) {
+        if (!proto_router.has_router()) {
+            return;
+        }
+        transport_router->GetRouter() =
+            std::make_unique<route::TransportRouter::Router>(transport_router->GetGraph(), false);
+        LoadRouter(catalogue, transport_router->GetGraph(), transport_router->GetRouter());
+    } else if (routing_settings.mode == route::RouterMode::CONTRACTION_HIERARCHY) {
+        if (!proto_router.has_contraction_hierarchy()) {
+            return;
+        }
+        LoadContractionHierarchy(*transport_router);
+    }
 
     transport_router->InternalInit();
 }
 
+void Serializator::LoadContractionHierarchy(route::TransportRouter& transport_router) const {
+    using ContractionHierarchy = route::TransportRouter::ContractionHierarchy;
+
+    auto& proto_hierarchy = proto_catalogue_.router().contraction_hierarchy();
+
+    std::vector<size_t> ranks(proto_hierarchy.rank().begin(), proto_hierarchy.rank().end());
+
+    std::vector<ContractionHierarchy::Shortcut> shortcuts;
+    shortcuts.reserve(proto_hierarchy.shortcuts_size());
+
+    for (const auto& proto_shortcut : proto_hierarchy.shortcuts()) {
+        ContractionHierarchy::Shortcut shortcut;
+
+        shortcut.from = proto_shortcut.from();
+        shortcut.to = proto_shortcut.to();
+        shortcut.weight.total_time = proto_shortcut.total_time();
+        shortcut.first = proto_shortcut.first_edge();
+        shortcut.second = proto_shortcut.second_edge();
+
+        shortcuts.push_back(std::move(shortcut));
+    }
+
+    transport_router.GetContractionHierarchy() = std::make_unique<ContractionHierarchy>(
+        transport_router.GetGraph(), std::move(ranks), std::move(shortcuts));
+}
+
 void Serializator::LoadTransportRouterSettings(route::RouteSettings& routing_settings) const {
     auto &proto_settings = proto_catalogue_.router().settings();
 
     routing_settings.bus_wait_time = proto_settings.wait_time();
     routing_settings.bus_velocity = proto_settings.velocity();
+    routing_settings.mode = static_cast<route::RouterMode>(proto_settings.mode());
+    routing_settings.graph_model = static_cast<route::GraphModel>(proto_settings.graph_model());
+
+    if (proto_settings.walk_velocity() > 0) {
+        routing_settings.walk_velocity = proto_settings.walk_velocity();
+        routing_settings.max_walk_distance = proto_settings.max_walk_distance();
+    }
 }
 
 void Serializator::LoadGraph(const TransportCatalogue& catalogue, route::TransportRouter::Graph& graph) {
@@ -456,38 +586,39 @@ void Serializator::LoadGraph(const TransportCatalogue& catalogue, route::Transpo
     }
 }
 
-void Serializator::LoadRouter(const TransportCatalogue& catalogue,
+void Serializator::LoadVertexStopIds(std::vector<int>& vertex_stop_ids) const {
+    auto& proto_vertex_stop_ids = proto_catalogue_.router().vertex_stop_id();
+
+    vertex_stop_ids.assign(proto_vertex_stop_ids.begin(), proto_vertex_stop_ids.end());
+}
+
+void Serializator::LoadRouter(const TransportCatalogue& catalogue, const route::TransportRouter::Graph& graph,
     std::unique_ptr<route::TransportRouter::Router>& router) {
-    
+
+    using Router = route::TransportRouter::Router;
+
     auto &proto_router = proto_catalogue_.router().router();
     auto &routes_internal_data = router->GetRoutesInternalData();
 
-    auto routes_internal_data_count = proto_router.routes_internal_data_size();
+    // Первые вершины графа — остановки справочника
+    if (graph.GetVertexCount() < static_cast<size_t>(catalogue.GetStopsSize())) {
+        throw std::runtime_error("routes matrix doesn't match the catalogue");
+    }
 
-    for (int i = 0; i < routes_internal_data_count; ++i) {
-        auto& proto_internal_data = proto_router.routes_internal_data(i);
-        auto internal_data_count = proto_internal_data.routes_internal_data_size();
-        
-        for (int j = 0; j < internal_data_count; ++j) {
-            auto& proto_optional_data = proto_internal_data.routes_internal_data(j);
-            
-            if (proto_optional_data.optional_route_internal_data_case() ==  proto_graph::OptionalRouteInternalData::kRouteInternalData) { 
-                route::TransportRouter::Router::RouteInternalData data;
-                auto& proto_data = proto_optional_data.route_internal_data();
-                data.weight.total_time = proto_data.total_time();
-                
-                if (proto_data.optional_prev_edge_case() == proto_graph::RouteInternalData::kPrevEdge) {
-                    data.prev_edge = proto_data.prev_edge();
-                } else {
-                    data.prev_edge = std::nullopt;
-                }
-                routes_internal_data[i][j] = std::move(data);
-            } else {
-                routes_internal_data[i][j] = std::nullopt;
-            }
-        }
+    if (static_cast<size_t>(proto_router.total_time_size()) != routes_internal_data.size()
+        || proto_router.prev_edge_size() != proto_router.total_time_size()) {
+        throw std::runtime_error("routes matrix doesn't match the graph");
     }
 
+    for (size_t i = 0; i < routes_internal_data.size(); ++i) {
+        const auto prev_edge = proto_router.prev_edge(i);
+
+        if (prev_edge != Router::NO_EDGE && prev_edge >= graph.GetEdgeCount()) {
+            throw std::runtime_error("routes matrix doesn't match the graph");
+        }
+
+        routes_internal_data[i] = {proto_router.total_time(i), prev_edge};
+    }
 }
 
 
@@ -7,14 +7,40 @@
 #include <transport_catalogue.pb.h>
 
 #include "map_renderer.h"
+#include "stop_index.h"
 #include "transport_catalogue.h"
 #include "transport_router.h"
 
 namespace serialize {
 
 
+// Что из маршрутизатора попадает в файл базы:
+// FULL — граф и предвычисленные данные режима (матрица, иерархия сжатий),
+// GRAPH — только граф, данные режима строятся при первом запросе Route,
+// SETTINGS — только настройки, граф тоже строится при первом запросе Route
+enum class RouterStorage {
+    FULL,
+    GRAPH,
+    SETTINGS,
+};
+
+// PROTOBUF — файл protobuf, при загрузке разбирается в справочник целиком,
+// MAPPED — образ, который отображается в память и читается без разбора (mapped_base.h)
+enum class BaseFormat {
+    PROTOBUF,
+    MAPPED,
+};
+
 struct Settings {
     std::filesystem::path file;
+    BaseFormat format = BaseFormat::PROTOBUF;
+    RouterStorage router_storage = RouterStorage::FULL;
+    // Печатать в std::cerr размер файла базы и время загрузки
+    bool report = false;
+    // Число потоков для тяжёлых этапов построения базы, 0 — по числу ядер
+    size_t threads = 1;
+    // Отрисовать карту при make_base и сохранить готовый SVG в базе
+    bool prerender_map = false;
 };
 
 
@@ -27,13 +53,22 @@ public:
 
     void SaveTransportCatalogue(const TransportCatalogue& catalogue);
     void SaveRenderSettings(transport::renderer::RenderSettings render_settings);
+    void SaveMapSvg(std::string map_svg);
+    void SaveStopIndex(const transport::StopIndex& stop_index);
     void SaveTransportRouter(const route::TransportRouter &router);
 
     bool Serialize();
 
     bool Deserialize(TransportCatalogue& catalogue, 
         std::optional<transport::renderer::RenderSettings>& result_settings, 
-        std::unique_ptr<route::TransportRouter> &router);
+        std::unique_ptr<route::TransportRouter> &router,
+        std::optional<std::string>& map_svg,
+        std::optional<transport::StopIndex>& stop_index);
+
+    static proto_map_renderer::RenderSettings MakeProtoRenderSettings(
+        const transport::renderer::RenderSettings& render_settings);
+    static transport::renderer::RenderSettings MakeRenderSettings(
+        const proto_map_renderer::RenderSettings& proto_settings);
 
 
 private:
@@ -43,25 +78,34 @@ private:
     void SaveBuses(const TransportCatalogue& catalogue);
     void LoadBuses(TransportCatalogue& catalogue);
 
-    void SaveBusStops(const transport::Bus& bus, proto_catalogue::Bus& proto_bus, const TransportCatalogue& catalogue);
+    void SaveBusStops(const transport::Bus& bus, proto_catalogue::Bus& proto_bus);
     void LoadBus(TransportCatalogue& catalogue, const proto_catalogue::Bus& proto_bus) const;
 
     void SaveDistances(const TransportCatalogue& catalogue);
     void LoadDistances(TransportCatalogue& catalogue) const;
 
+    void LoadStopIndex(const TransportCatalogue& catalogue,
+        std::optional<transport::StopIndex>& stop_index) const;
+
     void LoadRenderSettings(std::optional<transport::renderer::RenderSettings>& result_settings) const;
 
     void SaveTransportRouterSettings(const route::RouteSettings& routing_settings);
     void SaveGraph(const route::TransportRouter::Graph& graph);
+    void SaveVertexStopIds(const std::vector<int>& vertex_stop_ids);
     void SaveRouter(const std::unique_ptr<route::TransportRouter::Router>& router);
+    void SaveContractionHierarchy(const route::TransportRouter::ContractionHierarchy& hierarchy);
 
     void LoadTransportRouter(const TransportCatalogue& catalogue,
         std::unique_ptr<route::TransportRouter>& transport_router);
 
     void LoadTransportRouterSettings(route::RouteSettings& routing_settings) const;
     void LoadGraph(const TransportCatalogue& catalogue, route::TransportRouter::Graph& graph);
-    void LoadRouter(const TransportCatalogue& catalogue,
+    void LoadVertexStopIds(std::vector<int>& vertex_stop_ids) const;
+    // Матрица проверяется по справочнику и графу: испорченная или чужая
+    // база отвергается при загрузке, а не при обходе пути
+    void LoadRouter(const TransportCatalogue& catalogue, const route::TransportRouter::Graph& graph,
         std::unique_ptr<route::TransportRouter::Router>& router);
+    void LoadContractionHierarchy(route::TransportRouter& transport_router) const;
 
     proto_graph::RouteWeight MakeProtoWeight(const route::RouteWeight& weight) const;
     route::RouteWeight MakeWeight(const TransportCatalogue& catalogue,
@@ -78,7 +122,6 @@ private:
     Settings settings_;
     ProtoTransportCatalogue proto_catalogue_;
 
-    std::unordered_map<int, std::string_view> bus_name_by_id_;
     std::unordered_map<std::string_view, int> bus_id_by_name_;
 };
 
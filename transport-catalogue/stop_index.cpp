@@ -0,0 +1,231 @@
+#define _USE_MATH_DEFINES
+#include "stop_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+namespace transport {
+
+namespace {
+
+// Тот же радиус Земли, что в geo::ComputeDistance
+constexpr double EARTH_RADIUS = 6371000;
+constexpr double DEG_TO_RAD = M_PI / 180.;
+// Ячейка не бывает уже этого, даже если все остановки на одной широте или долготе
+constexpr double MIN_CELL_SIZE = 1e-9;
+// Запас на погрешность acos в geo::ComputeDistance
+constexpr double BOUND_TOLERANCE = 1e-6;
+
+// Номер полосы сетки, в которую попадает value; точки вне сетки прижимаются к краю
+uint32_t GetBand(double value, double min, double band_size, uint32_t bands_count) {
+    const double band = std::floor((value - min) / band_size);
+    return static_cast<uint32_t>(std::clamp(band, 0., static_cast<double>(bands_count - 1)));
+}
+
+bool IsCloser(const StopIndex::Found& lhs, const StopIndex::Found& rhs) {
+    return std::tie(lhs.distance, lhs.stop_id) < std::tie(rhs.distance, rhs.stop_id);
+}
+
+} // namespace
+
+StopIndex::StopIndex(Grid grid, const uint32_t* cell_offsets, const Entry* entries)
+    : grid_(grid)
+    , cell_offsets_(cell_offsets)
+    , entries_(entries)
+    , max_abs_lat_(std::max(std::abs(grid.min_lat), std::abs(grid.min_lat + grid.rows * grid.cell_lat))) {
+}
+
+StopIndex::StopIndex(Grid grid, std::vector<uint32_t> cell_offsets, std::vector<Entry> entries)
+    : grid_(grid)
+    , cell_offsets_storage_(std::move(cell_offsets))
+    , entries_storage_(std::move(entries))
+    , cell_offsets_(cell_offsets_storage_.data())
+    , entries_(entries_storage_.data())
+    , max_abs_lat_(std::max(std::abs(grid.min_lat), std::abs(grid.min_lat + grid.rows * grid.cell_lat))) {
+}
+
+StopIndex StopIndex::Build(const TransportCatalogue& catalogue) {
+    const auto& stops = catalogue.GetStops();
+
+    if (stops.empty()) {
+        return StopIndex(Grid{}, std::vector<uint32_t>{0}, {});
+    }
+
+    double min_lat = stops.front().coordinates.lat;
+    double max_lat = min_lat;
+    double min_lng = stops.front().coordinates.lng;
+    double max_lng = min_lng;
+
+    for (const Stop& stop : stops) {
+        min_lat = std::min(min_lat, stop.coordinates.lat);
+        max_lat = std::max(max_lat, stop.coordinates.lat);
+        min_lng = std::min(min_lng, stop.coordinates.lng);
+        max_lng = std::max(max_lng, stop.coordinates.lng);
+    }
+
+    // В среднем около двух остановок на ячейку
+    const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(stops.size() / 2.0)));
+
+    Grid grid;
+    grid.min_lat = min_lat;
+    grid.min_lng = min_lng;
+    grid.rows = std::max<uint32_t>(side, 1);
+    grid.cols = grid.rows;
+    grid.cell_lat = std::max((max_lat - min_lat) / grid.rows, MIN_CELL_SIZE);
+    grid.cell_lng = std::max((max_lng - min_lng) / grid.cols, MIN_CELL_SIZE);
+
+    // Сортировка подсчётом по ячейкам; внутри ячейки остановки идут по возрастанию id
+    std::vector<uint32_t> cells(stops.size());
+    std::vector<uint32_t> cell_offsets(static_cast<size_t>(grid.rows) * grid.cols + 1, 0);
+
+    for (const Stop& stop : stops) {
+        cells[stop.id] = GetBand(stop.coordinates.lat, grid.min_lat, grid.cell_lat, grid.rows) * grid.cols
+            + GetBand(stop.coordinates.lng, grid.min_lng, grid.cell_lng, grid.cols);
+        ++cell_offsets[cells[stop.id] + 1];
+    }
+
+    for (size_t i = 1; i < cell_offsets.size(); ++i) {
+        cell_offsets[i] += cell_offsets[i - 1];
+    }
+
+    std::vector<Entry> entries(stops.size());
+    std::vector<uint32_t> positions(cell_offsets.begin(), cell_offsets.end() - 1);
+
+    for (const Stop& stop : stops) {
+        entries[positions[cells[stop.id]]++] = Entry{stop.coordinates.lat, stop.coordinates.lng, stop.id};
+    }
+
+    return StopIndex(grid, std::move(cell_offsets), std::move(entries));
+}
+
+std::vector<StopIndex::Found> StopIndex::FindNearest(geo::Coordinates point,
+    size_t count, double max_distance) const {
+
+    std::vector<Found> result;
+
+    if (count == 0 || grid_.rows == 0 || cell_offsets_[GetCellsCount()] == 0) {
+        return result;
+    }
+
+    const uint32_t row = GetRow(point.lat);
+    const uint32_t col = GetCol(point.lng);
+
+    // result — куча с самой дальней из найденных остановок наверху
+    auto visit_cell = [&](int64_t cell_row, int64_t cell_col) {
+        const size_t cell = static_cast<size_t>(cell_row) * grid_.cols + static_cast<size_t>(cell_col);
+
+        for (uint32_t i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+            const Found candidate{entries_[i].stop_id,
+                geo::ComputeDistance(point, {entries_[i].lat, entries_[i].lng})};
+
+            if (candidate.distance > max_distance) {
+                continue;
+            }
+
+            if (result.size() < count) {
+                result.push_back(candidate);
+                std::push_heap(result.begin(), result.end(), IsCloser);
+            } else if (IsCloser(candidate, result.front())) {
+                std::pop_heap(result.begin(), result.end(), IsCloser);
+                result.back() = candidate;
+                std::push_heap(result.begin(), result.end(), IsCloser);
+            }
+        }
+    };
+
+    for (uint32_t ring = 0;; ++ring) {
+        const int64_t first_row = static_cast<int64_t>(row) - ring;
+        const int64_t last_row = static_cast<int64_t>(row) + ring;
+
+        for (int64_t cell_row = std::max<int64_t>(first_row, 0);
+             cell_row <= std::min<int64_t>(last_row, grid_.rows - 1); ++cell_row) {
+
+            // Во внутренних строках кольца только две ячейки — левая и правая
+            const bool is_edge_row = cell_row == first_row || cell_row == last_row;
+            const int64_t step = is_edge_row ? 1 : 2 * static_cast<int64_t>(ring);
+
+            for (int64_t cell_col = static_cast<int64_t>(col) - ring;
+                 cell_col <= static_cast<int64_t>(col) + ring; cell_col += step) {
+
+                if (cell_col >= 0 && cell_col < grid_.cols) {
+                    visit_cell(cell_row, cell_col);
+                }
+            }
+        }
+
+        const double bound = GetRingBound(point, row, col, ring);
+        const double worst = result.size() == count ? result.front().distance : max_distance;
+
+        if (std::isinf(bound) || bound - BOUND_TOLERANCE > worst) {
+            break;
+        }
+    }
+
+    std::sort_heap(result.begin(), result.end(), IsCloser);
+
+    return result;
+}
+
+double StopIndex::GetRingBound(geo::Coordinates point, uint32_t row, uint32_t col, uint32_t ring) const {
+    double bound = std::numeric_limits<double>::infinity();
+
+    // Расстояние не меньше разницы широт, умноженной на радиус
+    auto update_lat = [&](double border_lat) {
+        bound = std::min(bound, std::max(std::abs(point.lat - border_lat), 0.) * DEG_TO_RAD * EARTH_RADIUS);
+    };
+    // По формуле гаверсинусов d >= 2R * asin(cos(max|lat|) * sin(dlng / 2))
+    auto update_lng = [&](double border_lng) {
+        const double half_lng = std::abs(point.lng - border_lng) * DEG_TO_RAD / 2;
+        const double max_lat = std::max(max_abs_lat_, std::abs(point.lat)) * DEG_TO_RAD;
+        bound = std::min(bound,
+            2 * EARTH_RADIUS * std::asin(std::min(1., std::cos(max_lat) * std::sin(std::min(half_lng, M_PI / 2)))));
+    };
+
+    // Точка может лежать вне сетки: тогда граница квадрата по эту сторону от неё,
+    // и оценка по этой стороне равна нулю
+    if (row >= ring + 1) {
+        const double border = grid_.min_lat + (row - ring) * grid_.cell_lat;
+        update_lat(point.lat > border ? border : point.lat);
+    }
+    if (static_cast<uint64_t>(row) + ring + 1 < grid_.rows) {
+        const double border = grid_.min_lat + (static_cast<uint64_t>(row) + ring + 1) * grid_.cell_lat;
+        update_lat(point.lat < border ? border : point.lat);
+    }
+    if (col >= ring + 1) {
+        const double border = grid_.min_lng + (col - ring) * grid_.cell_lng;
+        update_lng(point.lng > border ? border : point.lng);
+    }
+    if (static_cast<uint64_t>(col) + ring + 1 < grid_.cols) {
+        const double border = grid_.min_lng + (static_cast<uint64_t>(col) + ring + 1) * grid_.cell_lng;
+        update_lng(point.lng < border ? border : point.lng);
+    }
+
+    return bound;
+}
+
+uint32_t StopIndex::GetRow(double lat) const {
+    return GetBand(lat, grid_.min_lat, grid_.cell_lat, grid_.rows);
+}
+
+uint32_t StopIndex::GetCol(double lng) const {
+    return GetBand(lng, grid_.min_lng, grid_.cell_lng, grid_.cols);
+}
+
+const StopIndex::Grid& StopIndex::GetGrid() const {
+    return grid_;
+}
+
+size_t StopIndex::GetCellsCount() const {
+    return static_cast<size_t>(grid_.rows) * grid_.cols;
+}
+
+ranges::Range<const uint32_t*> StopIndex::GetCellOffsets() const {
+    return {cell_offsets_, cell_offsets_ + (cell_offsets_ ? GetCellsCount() + 1 : 0)};
+}
+
+ranges::Range<const StopIndex::Entry*> StopIndex::GetEntries() const {
+    return {entries_, entries_ + (cell_offsets_ ? cell_offsets_[GetCellsCount()] : 0)};
+}
+
+} // transport
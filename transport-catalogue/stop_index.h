@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "geo.h"
+#include "ranges.h"
+#include "transport_catalogue.h"
+
+namespace transport {
+
+// Пространственный индекс остановок: равномерная сетка по широте и долготе.
+// Остановки каждой ячейки лежат подряд, как списки инцидентности в CSR:
+// ячейка i — это entries[cell_offsets[i]] .. entries[cell_offsets[i + 1]].
+// Поиск обходит ячейки кольцами вокруг точки запроса и останавливается,
+// когда ближе уже ничего быть не может
+class StopIndex {
+public:
+    struct Grid {
+        double min_lat = 0;
+        double min_lng = 0;
+        double cell_lat = 1;
+        double cell_lng = 1;
+        uint32_t rows = 0;
+        uint32_t cols = 0;
+    };
+
+    // Координаты лежат в самом индексе, чтобы поиск не ходил в справочник
+    struct Entry {
+        double lat;
+        double lng;
+        StopId stop_id;
+        uint32_t reserved = 0;
+    };
+
+    struct Found {
+        StopId stop_id;
+        double distance;
+    };
+
+    StopIndex() = default;
+    // Индекс поверх чужой памяти, например отображённого файла базы
+    StopIndex(Grid grid, const uint32_t* cell_offsets, const Entry* entries);
+    StopIndex(Grid grid, std::vector<uint32_t> cell_offsets, std::vector<Entry> entries);
+
+    // Указатели смотрят в собственные векторы, поэтому копировать нельзя
+    StopIndex(const StopIndex&) = delete;
+    StopIndex& operator=(const StopIndex&) = delete;
+    StopIndex(StopIndex&&) = default;
+    StopIndex& operator=(StopIndex&&) = default;
+
+    static StopIndex Build(const TransportCatalogue& catalogue);
+
+    // Не больше count ближайших остановок не дальше max_distance метров,
+    // по возрастанию расстояния
+    std::vector<Found> FindNearest(geo::Coordinates point,
+        size_t count = std::numeric_limits<size_t>::max(),
+        double max_distance = std::numeric_limits<double>::infinity()) const;
+
+    const Grid& GetGrid() const;
+    size_t GetCellsCount() const;
+    ranges::Range<const uint32_t*> GetCellOffsets() const;
+    ranges::Range<const Entry*> GetEntries() const;
+
+private:
+    uint32_t GetRow(double lat) const;
+    uint32_t GetCol(double lng) const;
+    // Нижняя оценка расстояния до любой остановки вне квадрата из ячеек
+    // в пределах ring от (row, col); бесконечность, если квадрат покрыл всю сетку
+    double GetRingBound(geo::Coordinates point, uint32_t row, uint32_t col, uint32_t ring) const;
+
+    Grid grid_;
+    std::vector<uint32_t> cell_offsets_storage_;
+    std::vector<Entry> entries_storage_;
+
+    const uint32_t* cell_offsets_ = nullptr;
+    const Entry* entries_ = nullptr;
+    // Наибольший модуль широты в сетке: по нему оценивается длина градуса долготы
+    double max_abs_lat_ = 0;
+};
+
+} // transport
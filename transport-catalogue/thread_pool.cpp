@@ -0,0 +1,68 @@
+#include "thread_pool.h"
+
+namespace concurrency {
+
+thread_local bool ThreadPool::in_parallel_for_ = false;
+
+size_t ResolveThreadsCount(size_t threads_count) {
+    if (threads_count > 0) {
+        return threads_count;
+    }
+
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+ThreadPool::ThreadPool(size_t threads_count) {
+    threads_count = ResolveThreadsCount(threads_count);
+
+    // Вызывающий поток работает наравне с рабочими, поэтому их на один меньше
+    for (size_t i = 1; i < threads_count; ++i) {
+        workers_.emplace_back([this] {
+            WorkerLoop();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        stopped_ = true;
+    }
+    jobs_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetThreadsCount() const {
+    return workers_.size() + 1;
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard guard(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    jobs_cv_.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex_);
+            jobs_cv_.wait(lock, [this] { return stopped_ || !jobs_.empty(); });
+
+            if (jobs_.empty()) {
+                return;
+            }
+
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace concurrency
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Пул рабочих потоков с простой очередью задач. Потоки создаются один раз
+// и переиспользуются между вызовами ParallelFor
+class ThreadPool {
+public:
+    // threads_count == 0 означает «по числу ядер»; при одном потоке
+    // рабочие потоки не создаются и всё выполняется в вызывающем
+    explicit ThreadPool(size_t threads_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t GetThreadsCount() const;
+
+    // Вызывает task(i) для каждого i из [0, count) и дожидается завершения.
+    // Вызывающий поток тоже участвует в работе. Первое выброшенное
+    // задачей исключение пробрасывается наружу. Вложенный вызов из задачи
+    // выполняется последовательно: иначе занятые потоки ждали бы друг друга
+    template <typename Task>
+    void ParallelFor(size_t count, const Task& task);
+
+private:
+    void Submit(std::function<void()> job);
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable jobs_cv_;
+    bool stopped_ = false;
+
+    // Поток сейчас выполняет задачу ParallelFor
+    static thread_local bool in_parallel_for_;
+};
+
+size_t ResolveThreadsCount(size_t threads_count);
+
+template <typename Task>
+void ThreadPool::ParallelFor(size_t count, const Task& task) {
+    if (count == 0) {
+        return;
+    }
+
+    if (workers_.empty() || count == 1 || in_parallel_for_) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index{0};
+    std::exception_ptr error;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t jobs_left = std::min(workers_.size(), count - 1);
+
+    auto run = [&] {
+        in_parallel_for_ = true;
+
+        try {
+            for (size_t i = next_index++; i < count; i = next_index++) {
+                task(i);
+            }
+        } catch (...) {
+            std::lock_guard guard(done_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next_index = count;
+        }
+
+        in_parallel_for_ = false;
+    };
+
+    for (size_t job = jobs_left; job > 0; --job) {
+        Submit([&] {
+            run();
+            std::lock_guard guard(done_mutex);
+            if (--jobs_left == 0) {
+                done_cv.notify_one();
+            }
+        });
+    }
+
+    run();
+
+    std::unique_lock lock(done_mutex);
+    done_cv.wait(lock, [&] { return jobs_left == 0; });
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace concurrency
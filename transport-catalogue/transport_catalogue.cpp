@@ -7,90 +7,156 @@ using namespace std;
 namespace transport {
 
 int TransportCatalogue::GetStopsSize() const {
-    return stopname_to_stop_.size();
+    return stops_.size();
 }
 
-int TransportCatalogue::GetStopId(const std::string_view& name) const {
-    return stopname_to_stop_.at(name)->id;
+int TransportCatalogue::GetBusesSize() const {
+    return buses_.size();
 }
 
-void TransportCatalogue::AddStop(const parsed::Stop& stop) {
-    int tmp_id = stop_id_;
-
-    Stop s = Stop{stop.name, geo::Coordinates{stop.lat, stop.lng}, set<string_view>{}, stop_id_++};
-    
-    stops_.push_back(move(s));
+StopId TransportCatalogue::GetStopId(const std::string_view& name) const {
+    return stopname_to_id_.at(name);
+}
 
-    Stop* added = &stops_.back();
+void TransportCatalogue::AddStop(const parsed::Stop& stop) {
+    const auto id = static_cast<StopId>(stops_.size());
 
-    stopname_to_stop_[string_view{added->name}] = added;
-    stop_id_to_stop_[tmp_id] = added;
+    stops_.push_back(Stop{stop.name, geo::Coordinates{stop.lat, stop.lng}, set<string_view>{}, id});
+    stop_trigs_.push_back(geo::ComputeLatitudeTrig(stop.lat));
+    stopname_to_id_[string_view{stops_.back().name}] = id;
 }
 
 void TransportCatalogue::AddDistances(const parsed::Distances& dists) {
-    Stop* from = stopname_to_stop_.at(dists.from);
+    const StopId from = stopname_to_id_.at(dists.from);
 
     for (const auto& [dest, meters] : dists.d_map) {
-        Stop* to = stopname_to_stop_.at(dest);
+        AddDistance(from, stopname_to_id_.at(dest), meters);
+    }
+}
+
+void TransportCatalogue::AddDistance(StopId from, StopId to, int meters) {
+    distances_[{from, to}] = meters;
+    distances_.emplace(std::pair{to, from}, meters);
+}
 
-        distances_[{from, to}] = meters;
+void TransportCatalogue::AddBus(const parsed::Bus& bus) {
+    vector<StopId> stops;
+    stops.reserve(bus.stops.size());
 
-        if (distances_.count({to, from}) == 0) {
-            distances_[{to, from}] = meters;
-        }
+    for (const string& el : bus.stops) {
+        stops.push_back(stopname_to_id_.at(el));
     }
+
+    AddBus(bus.name, stops, bus.circular);
 }
 
-void TransportCatalogue::AddBus(const parsed::Bus& bus) {
-    Bus b;
-    b.name = bus.name;
-    b.circular = bus.circular;
+BusId TransportCatalogue::AddBus(string name, const vector<StopId>& stops, bool circular) {
+    const auto id = static_cast<BusId>(buses_.size());
 
-    buses_.push_back(move(b));
+    buses_.push_back(Bus{move(name), {}, circular, id});
 
-    Bus* added = &buses_.back();
-    bus_names_.insert(string_view{added->name});
+    Bus& added = buses_.back();
+    const string_view added_name{added.name};
+    bus_names_.insert(added_name);
 
-    for (const string& el : bus.stops) {
-        added->bus_stops.push_back(stopname_to_stop_.at(el));
-        stopname_to_stop_.at(el)->buses_through.insert(string_view{added->name});
+    added.bus_stops.reserve(stops.size());
+
+    for (StopId stop_id : stops) {
+        Stop& stop = stops_.at(stop_id);
+
+        added.bus_stops.push_back(&stop);
+        stop.buses_through.insert(added_name);
     }
 
-    busname_to_bus_[string_view{added->name}] = added;
+    busname_to_id_[added_name] = id;
+    bus_distances_.push_back(CalculateDistances(added));
+    bus_stats_.push_back(CalculateStat(added, bus_distances_.back()));
 
-    bus_stats_[string_view{added->name}] = CalculateStat(added->name);
+    return id;
 }
 
 bool TransportCatalogue::FindStop(const string& name) const {
-    return stopname_to_stop_.count(name) > 0;
+    return stopname_to_id_.count(name) > 0;
 }
 
 bool TransportCatalogue::FindBus(const string& name) const {
-    return busname_to_bus_.count(name) > 0;
+    return busname_to_id_.count(name) > 0;
+}
+
+optional<StopId> TransportCatalogue::FindStopId(string_view name) const {
+    const auto it = stopname_to_id_.find(name);
+
+    if (it == stopname_to_id_.end()) {
+        return nullopt;
+    }
+    return it->second;
+}
+
+optional<BusId> TransportCatalogue::FindBusId(string_view name) const {
+    const auto it = busname_to_id_.find(name);
+
+    if (it == busname_to_id_.end()) {
+        return nullopt;
+    }
+    return it->second;
 }
 
 optional<BusStat> TransportCatalogue::GetBusStat(const string& name) const {
-    if (bus_stats_.count(name) == 0) {
+    const auto id = FindBusId(name);
+
+    if (!id) {
         return nullopt;
     }
 
-    return bus_stats_.at(name);
+    return bus_stats_[*id];
 }
 
-std::string TransportCatalogue::GetStopNameById(int id) const {
-    return stop_id_to_stop_.at(id)->name;
+std::string TransportCatalogue::GetStopNameById(StopId id) const {
+    return stops_.at(id).name;
 }
 
-set<string_view>* TransportCatalogue::GetBusesThroughStop(const string& name) const {
-    if (stopname_to_stop_.count(name) == 0) {
+const Stop& TransportCatalogue::GetStopById(StopId id) const {
+    return stops_.at(id);
+}
+
+const Bus& TransportCatalogue::GetBusById(BusId id) const {
+    return buses_.at(id);
+}
+
+const BusStat& TransportCatalogue::GetBusStatById(BusId id) const {
+    return bus_stats_.at(id);
+}
+
+BusStat TransportCatalogue::ComputeBusStat(BusId id) const {
+    const Bus& bus = buses_.at(id);
+    return CalculateStat(bus, CalculateDistances(bus));
+}
+
+int TransportCatalogue::GetDistance(StopId from, StopId to) const {
+    return distances_.at({from, to});
+}
+
+uint64_t TransportCatalogue::GetBusDistance(BusId id, size_t from_index, size_t to_index) const {
+    const BusDistances& distances = bus_distances_.at(id);
+
+    if (from_index <= to_index) {
+        return distances.forward.at(to_index) - distances.forward.at(from_index);
+    }
+    return distances.backward.at(from_index) - distances.backward.at(to_index);
+}
+
+const set<string_view>* TransportCatalogue::GetBusesThroughStop(const string& name) const {
+    const auto id = FindStopId(name);
+
+    if (!id) {
         return nullptr;
     }
 
-    return &stopname_to_stop_.at(name)->buses_through;
+    return &stops_[*id].buses_through;
 }
 
 unsigned int TransportCatalogue::GetStopsDistance(const string& from, const string& dest) const {
-    return distances_.at({stopname_to_stop_.at(from), stopname_to_stop_.at(dest)});
+    return GetDistance(stopname_to_id_.at(from), stopname_to_id_.at(dest));
 }
 
 
@@ -99,70 +165,89 @@ const set<string_view>* TransportCatalogue::GetBusNames() const {
 }
 
 const Bus* TransportCatalogue::GetBus(string_view name) const {
-    return busname_to_bus_.at(name);
+    return &buses_[busname_to_id_.at(name)];
 }
 
-const std::unordered_map<std::string_view, Stop*> TransportCatalogue::GetStops() const {
-    return stopname_to_stop_;
+const std::deque<Stop>& TransportCatalogue::GetStops() const {
+    return stops_;
 }
 
-const std::unordered_map<std::string_view, Bus*> TransportCatalogue::GetBuses() const {
-    return busname_to_bus_;
+const std::deque<Bus>& TransportCatalogue::GetBuses() const {
+    return buses_;
 }
 
-const std::unordered_map<std::pair<Stop*, Stop*>, int, TransportCatalogue::DistanceHasher> TransportCatalogue::GetDistances() const {
+const TransportCatalogue::Distances& TransportCatalogue::GetDistances() const {
     return distances_;
 }
 
-BusStat TransportCatalogue::CalculateStat(const string& name) const {
-    Bus* b = busname_to_bus_.at(name);
+TransportCatalogue::BusDistances TransportCatalogue::CalculateDistances(const Bus& bus) const {
+    const size_t stops_count = bus.bus_stops.size();
+
+    BusDistances result;
+    result.forward.resize(stops_count);
+    result.backward.resize(stops_count);
+
+    for (size_t i = 1; i < stops_count; ++i) {
+        const StopId prev = bus.bus_stops[i - 1]->id;
+        const StopId cur = bus.bus_stops[i]->id;
+
+        result.forward[i] = result.forward[i - 1] + distances_.at({prev, cur});
+        // Обратный путь считаем только для некольцевых: у кольцевых он не нужен
+        // и расстояние против хода может быть не задано
+        if (!bus.circular) {
+            result.backward[i] = result.backward[i - 1] + distances_.at({cur, prev});
+        }
+    }
+
+    return result;
+}
+
+BusStat TransportCatalogue::CalculateStat(const Bus& bus, const BusDistances& distances) const {
+    const Bus* b = &bus;
 
     int stops_count = b->bus_stops.size();
     int unique_stops_count = 0;
-    double geo_length = 0;
-    unsigned int actual_length = 0;
+    unsigned int actual_length = distances.forward.empty() ? 0 : distances.forward.back();
 
     set<string_view> uniq_stops;
+    geo::PathPoints path;
+    path.Reserve(b->bus_stops.size());
 
     for (size_t i = 0; i < b->bus_stops.size(); ++i) {
+        const Stop* stop = b->bus_stops[i];
+        path.Add(stop->coordinates, stop_trigs_[stop->id]);
+
         if (i == b->bus_stops.size() - 1) {
-            if (uniq_stops.count(b->bus_stops[i]->name) == 0) {
+            if (uniq_stops.count(stop->name) == 0) {
                 ++unique_stops_count;
             }
 
             break;
         }
 
-        if (uniq_stops.count(b->bus_stops[i]->name) == 0) {
+        if (uniq_stops.count(stop->name) == 0) {
             ++unique_stops_count;
-            uniq_stops.insert(b->bus_stops[i]->name);
+            uniq_stops.insert(stop->name);
         }
-
-        geo_length += geo::ComputeDistance(b->bus_stops[i]->coordinates, b->bus_stops[i + 1]->coordinates);
-        actual_length += distances_.at({b->bus_stops[i], b->bus_stops[i + 1]});
     }
 
+    double geo_length = geo::ComputePathLength(path);
+
     if (!b->circular) {
         geo_length *= 2;
         stops_count *=2;
         --stops_count;
 
-        for (size_t i = b->bus_stops.size() - 1; i > 0; --i) {
-            actual_length += distances_.at({b->bus_stops[i], b->bus_stops[i - 1]});
+        if (!distances.backward.empty()) {
+            actual_length += distances.backward.back();
         }
     }
 
     return BusStat{stops_count, unique_stops_count, actual_length, actual_length / geo_length};
 }
 
-size_t TransportCatalogue::DistanceHasher::operator()(const pair<Stop*, Stop*>& p) const {
-    size_t lat_1 = d_hasher_(p.first->coordinates.lat);
-    size_t lng_1 = d_hasher_(p.first->coordinates.lng);
-
-    size_t lat_2 = d_hasher_(p.second->coordinates.lat);
-    size_t lng_2 = d_hasher_(p.second->coordinates.lng);
-
-    return lat_1 + lng_1 * 37 + lat_2 * (37 * 37) + lng_2 * (37 * 37 * 37);
+size_t TransportCatalogue::DistanceHasher::operator()(const pair<StopId, StopId>& p) const {
+    return hasher_((static_cast<uint64_t>(p.first) << 32) | p.second);
 }
 
-} // transport
\ No newline at end of file
+} // transport
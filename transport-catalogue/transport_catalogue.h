@@ -1,59 +1,93 @@
 #pragma once
 
+#include <cstdint>
 #include <deque>
 #include <optional>
 #include <set>
+#include <vector>
 
 #include "domain.h"
 
 namespace transport {
 
+// Остановки и автобусы хранятся подряд в порядке добавления: StopId и BusId —
+// индексы в stops_ и buses_. Названия разрешаются в идентификаторы только
+// на границе с запросами, маршрутизатор и сериализатор работают с номерами
 class TransportCatalogue {
 private:
+    // Пара номеров остановок упаковывается в одно 64-битное число
     struct DistanceHasher {
-        size_t operator()(const std::pair<Stop*, Stop*>& p) const;
+        size_t operator()(const std::pair<StopId, StopId>& p) const;
 
     private:
-        std::hash<double> d_hasher_;
+        std::hash<uint64_t> hasher_;
+    };
+
+    using Distances = std::unordered_map<std::pair<StopId, StopId>, int, DistanceHasher>;
+
+    // Префиксные суммы перегонов автобуса: forward[i] — путь от первой остановки
+    // до i-й, backward[i] — путь от i-й обратно до первой
+    struct BusDistances {
+        std::vector<uint64_t> forward;
+        std::vector<uint64_t> backward;
     };
-    
 
-    int stop_id_ = 0;
     std::deque<Stop> stops_;
-    std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
+    // Тригонометрия широт остановок по StopId для длин маршрутов по карте
+    std::vector<geo::LatitudeTrig> stop_trigs_;
+    std::unordered_map<std::string_view, StopId> stopname_to_id_;
     
     std::deque<Bus> buses_;
     std::set<std::string_view> bus_names_;
-    std::unordered_map<std::string_view, BusStat> bus_stats_;
-    std::unordered_map<std::string_view, Bus*> busname_to_bus_;
+    std::vector<BusStat> bus_stats_;
+    std::vector<BusDistances> bus_distances_;
+    std::unordered_map<std::string_view, BusId> busname_to_id_;
 
-    std::unordered_map<int, Stop*> stop_id_to_stop_;
+    Distances distances_;
 
-    std::unordered_map<std::pair<Stop*, Stop*>, int, DistanceHasher> distances_;
-
-    BusStat CalculateStat(const std::string& name) const;
+    BusDistances CalculateDistances(const Bus& bus) const;
+    BusStat CalculateStat(const Bus& bus, const BusDistances& distances) const;
     
 public:
     void AddStop(const parsed::Stop& stop);
     void AddBus(const parsed::Bus& route);
     void AddDistances(const parsed::Distances& dists);
+
+    // То же по идентификаторам, без поиска по названиям
+    BusId AddBus(std::string name, const std::vector<StopId>& stops, bool circular);
+    void AddDistance(StopId from, StopId to, int meters);
     
     bool FindStop(const std::string& name) const;
     bool FindBus(const std::string& name) const;
 
+    std::optional<StopId> FindStopId(std::string_view name) const;
+    std::optional<BusId> FindBusId(std::string_view name) const;
+
     int GetStopsSize() const;
-    int GetStopId(const std::string_view& name) const;
-    std::string GetStopNameById(int id) const;
+    int GetBusesSize() const;
+    StopId GetStopId(const std::string_view& name) const;
+    std::string GetStopNameById(StopId id) const;
+
+    const Stop& GetStopById(StopId id) const;
+    const Bus& GetBusById(BusId id) const;
+    const BusStat& GetBusStatById(BusId id) const;
+    // Статистика автобуса, посчитанная заново, а не из кэша bus_stats_
+    BusStat ComputeBusStat(BusId id) const;
+    int GetDistance(StopId from, StopId to) const;
+    // Путь автобуса между остановками маршрута с индексами from_index и to_index;
+    // при from_index > to_index — в обратном направлении
+    uint64_t GetBusDistance(BusId id, size_t from_index, size_t to_index) const;
 
-    const std::unordered_map<std::string_view, Stop*> GetStops() const;
-    const std::unordered_map<std::string_view, Bus*> GetBuses() const;
-    const std::unordered_map<std::pair<Stop*, Stop*>, int, DistanceHasher> GetDistances() const;
+    // Все остановки и автобусы в порядке идентификаторов
+    const std::deque<Stop>& GetStops() const;
+    const std::deque<Bus>& GetBuses() const;
+    const Distances& GetDistances() const;
 
     const std::set<std::string_view>* GetBusNames() const;
     const Bus* GetBus(std::string_view name) const;
-    std::set<std::string_view>* GetBusesThroughStop(const std::string& name) const;
+    const std::set<std::string_view>* GetBusesThroughStop(const std::string& name) const;
     std::optional<BusStat> GetBusStat(const std::string& name) const;
     unsigned int GetStopsDistance(const std::string& from, const std::string& dest) const;
 };
 
-} // transport
\ No newline at end of file
+} // transport
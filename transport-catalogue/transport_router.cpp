@@ -1,5 +1,8 @@
 #include "transport_router.h"
+#include "profile.h"
 
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 
 namespace route {
@@ -8,18 +11,84 @@ TransportRouter::TransportRouter(const transport::TransportCatalogue& catalogue,
     const RouteSettings& settings) : catalogue_(catalogue), settings_(settings) {
 }
 
+void TransportRouter::BuildGraph() {
+    if (!is_graph_initialized_) {
+        profile::ScopedTimer timer("TransportRouter::BuildGraph"sv);
+        const auto start = std::chrono::steady_clock::now();
+
+        if (settings_.graph_model == GraphModel::TRANSFER) {
+            BuildTransferEdges();
+        } else {
+            graph::DirectedWeightedGraph<RouteWeight>graph(catalogue_.GetStopsSize());
+            graph_ = std::move(graph);
+
+            BuildEdges();
+        }
+
+        if (report_stats_) {
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::cerr << "Graph built in " << elapsed.count() << " ms: " << graph_.GetVertexCount()
+                      << " vertices, " << graph_.GetEdgeCount() << " edges" << std::endl;
+        }
+
+        profile::Count("graph.vertices"sv, graph_.GetVertexCount());
+        profile::Count("graph.edges"sv, graph_.GetEdgeCount());
+
+        InternalGraphInit();
+    }
+}
+
 void TransportRouter::InitRouter() {
     if (!is_initialized_) {
-        graph::DirectedWeightedGraph<RouteWeight>graph(catalogue_.GetStopsSize());
-        graph_ = std::move(graph);
- 
-        BuildEdges();
+        profile::ScopedTimer timer("TransportRouter::InitRouter"sv);
+
+        BuildGraph();
+
+        if (settings_.mode == RouterMode::ALL_PAIRS) {
+            router_ = std::make_unique<Router>(graph_, true, threads_count_);
+        } else if (settings_.mode == RouterMode::CONTRACTION_HIERARCHY) {
+            contraction_hierarchy_ = std::make_unique<ContractionHierarchy>(graph_);
+        }
+
+        InternalInit();
+    }
+}
 
-        router_ = std::make_unique<graph::Router<RouteWeight>>(graph_);
-        is_initialized_ = true;
+void TransportRouter::InitDijkstraRouter() {
+    if (!dijkstra_router_) {
+        BuildGraph();
+        dijkstra_router_ = std::make_unique<DijkstraRouter>(graph_);
     }
 }
 
+std::optional<std::vector<graph::EdgeId>>
+TransportRouter::FindRouteEdges(graph::VertexId from, graph::VertexId to) const {
+    if (settings_.mode == RouterMode::DIJKSTRA) {
+        auto route = dijkstra_router_->BuildRoute(from, to);
+
+        if (!route) {
+            return std::nullopt;
+        }
+        return std::move(route->edges);
+    }
+
+    if (settings_.mode == RouterMode::CONTRACTION_HIERARCHY) {
+        auto route = contraction_hierarchy_->BuildRoute(from, to);
+
+        if (!route) {
+            return std::nullopt;
+        }
+        return std::move(route->edges);
+    }
+
+    auto route = router_->BuildRoute(from, to);
+
+    if (!route) {
+        return std::nullopt;
+    }
+    return std::move(route->edges);
+}
+
 std::optional<TransportRouter::TransportRoute>
 TransportRouter::BuildRoute(const std::string& from, const std::string& to) {
     if (from == to) {
@@ -30,25 +99,93 @@ TransportRouter::BuildRoute(const std::string& from, const std::string& to) {
 
     auto from_id = catalogue_.GetStopId(from);
     auto to_id = catalogue_.GetStopId(to);
-    auto route = router_->BuildRoute(from_id, to_id);
+    auto route_edges = FindRouteEdges(from_id, to_id);
     
+    if (!route_edges) {
+        return std::nullopt;
+    }
+
+    return MakeRides(*route_edges);
+}
+
+std::optional<TransportRouter::WalkRoute>
+TransportRouter::BuildRoute(const std::vector<WalkStop>& sources, const std::vector<WalkStop>& targets) {
+    InitDijkstraRouter();
+
+    auto route = dijkstra_router_->BuildRoute(MakeTerminals(sources), MakeTerminals(targets));
+
     if (!route) {
         return std::nullopt;
     }
 
-    TransportRoute result;
+    return WalkRoute{static_cast<StopId>(route->from), static_cast<StopId>(route->to), route->weight.total_time,
+        MakeRides(route->edges)};
+}
+
+std::vector<std::optional<TransportRouter::RouteTime>>
+TransportRouter::BuildRoutes(StopId from, const std::vector<StopId>& to, bool with_rides) {
+    InitDijkstraRouter();
 
-    for (auto edge_id : route->edges) {
-        const auto &edge = graph_.GetEdge(edge_id);
-        RouterEdge route_edge;
-        route_edge.bus_name = edge.weight.bus_name;
-        route_edge.stop_from = catalogue_.GetStopNameById(edge.from);
-        route_edge.stop_to = catalogue_.GetStopNameById(edge.to);
-        route_edge.span_count = edge.weight.span_count;
-        route_edge.total_time = edge.weight.total_time;
+    const std::vector<graph::VertexId> targets(to.begin(), to.end());
+    auto routes = dijkstra_router_->BuildRoutes(from, targets, with_rides);
 
-        result.push_back(route_edge);
+    std::vector<std::optional<RouteTime>> result;
+    result.reserve(routes.size());
+
+    for (auto& route : routes) {
+        if (!route) {
+            result.emplace_back(std::nullopt);
+            continue;
+        }
+
+        RouteTime route_time{route->weight.total_time, {}};
+
+        if (with_rides) {
+            route_time.rides = MakeRides(route->edges);
+        }
+
+        result.push_back(std::move(route_time));
     }
+
+    return result;
+}
+
+std::vector<ReachedStop> TransportRouter::FindReachableStops(StopId from, double max_time) {
+    InitDijkstraRouter();
+
+    return MakeReachedStops(dijkstra_router_->FindReachable(from, RouteWeight{{}, max_time, 0}),
+        catalogue_.GetStopsSize());
+}
+
+TransportRouter::TransportRoute TransportRouter::MakeRides(const std::vector<graph::EdgeId>& edges) const {
+    return MakeTransportRoute(graph_, vertex_stop_ids_.data(), catalogue_.GetStopsSize(), edges,
+        [this](StopId id) -> const std::string& {
+            return catalogue_.GetStopById(id).name;
+        });
+}
+
+std::vector<ReachedStop> MakeReachedStops(
+    const std::vector<std::pair<graph::VertexId, RouteWeight>>& reachable, size_t stops_count) {
+
+    std::vector<ReachedStop> result;
+
+    for (const auto& [vertex, weight] : reachable) {
+        if (vertex < stops_count) {
+            result.push_back({static_cast<StopId>(vertex), weight.total_time});
+        }
+    }
+
+    return result;
+}
+
+std::vector<graph::Terminal<RouteWeight>> MakeTerminals(const std::vector<WalkStop>& walk_stops) {
+    std::vector<graph::Terminal<RouteWeight>> result;
+    result.reserve(walk_stops.size());
+
+    for (const auto& [stop_id, walk_time] : walk_stops) {
+        result.push_back({stop_id, RouteWeight{{}, walk_time, 0}});
+    }
+
     return result;
 }
 
@@ -60,7 +197,32 @@ RouteSettings& TransportRouter::GetSettings() {
     return settings_;
 }
 
+void TransportRouter::SetThreadsCount(size_t threads_count) {
+    threads_count_ = threads_count;
+}
+
+void TransportRouter::SetReportStats(bool report_stats) {
+    report_stats_ = report_stats;
+}
+
+bool TransportRouter::IsInitialized() const {
+    return is_initialized_;
+}
+
+bool TransportRouter::IsGraphInitialized() const {
+    return is_graph_initialized_;
+}
+
+void TransportRouter::InternalGraphInit() {
+    is_graph_initialized_ = true;
+}
+
+// Дейкстра нужна и остальным режимам: маршруты между точками ищутся ею.
+// Если она уже создана InitDijkstraRouter, её могут читать другие потоки
 void TransportRouter::InternalInit() {
+    if (!dijkstra_router_) {
+        dijkstra_router_ = std::make_unique<DijkstraRouter>(graph_);
+    }
     is_initialized_ = true;
 }
 
@@ -71,6 +233,13 @@ const TransportRouter::Graph& TransportRouter::GetGraph() const {
     return graph_;
 }
 
+std::vector<int>& TransportRouter::GetVertexStopIds() {
+    return vertex_stop_ids_;
+}
+const std::vector<int>& TransportRouter::GetVertexStopIds() const {
+    return vertex_stop_ids_;
+}
+
 std::unique_ptr<TransportRouter::Router>& TransportRouter::GetRouter() {
     return router_;
 }
@@ -78,54 +247,149 @@ const std::unique_ptr<TransportRouter::Router>& TransportRouter::GetRouter() con
     return router_;
 }
 
+std::unique_ptr<TransportRouter::ContractionHierarchy>& TransportRouter::GetContractionHierarchy() {
+    return contraction_hierarchy_;
+}
+const std::unique_ptr<TransportRouter::ContractionHierarchy>& TransportRouter::GetContractionHierarchy() const {
+    return contraction_hierarchy_;
+}
+
 
 void TransportRouter::BuildEdges() {
-    for (const auto& [bus_name, bus] : catalogue_.GetBuses()) {
-        int stops_count = static_cast<int>(bus->bus_stops.size());
+    vertex_stop_ids_.resize(catalogue_.GetStopsSize());
 
-        for(int i = 0; i < stops_count - 1; ++i) {
+    for (int id = 0; id < catalogue_.GetStopsSize(); ++id) {
+        vertex_stop_ids_[id] = id;
+    }
+
+    // С i-й остановки маршрута выходит по ребру до каждой следующей,
+    // у некольцевого ещё и до каждой предыдущей
+    std::vector<size_t> out_degrees(catalogue_.GetStopsSize());
 
-            double route_time = settings_.bus_wait_time;
-            double route_time_back = settings_.bus_wait_time;
+    for (const transport::Bus& bus : catalogue_.GetBuses()) {
+        const size_t stops_count = bus.bus_stops.size();
 
+        for (size_t i = 0; i < stops_count; ++i) {
+            out_degrees[bus.bus_stops[i]->id] += stops_count - 1 - i + (bus.circular ? 0 : i);
+        }
+    }
+
+    graph_.ReserveEdges(out_degrees);
+
+    // Время каждого ребра — разность префиксных сумм перегонов автобуса
+    for (const transport::Bus& bus_item : catalogue_.GetBuses()) {
+        const transport::Bus* bus = &bus_item;
+        int stops_count = static_cast<int>(bus->bus_stops.size());
+
+        for(int i = 0; i < stops_count - 1; ++i) {
             for(int j = i + 1; j < stops_count; ++j) {
-                graph::Edge<RouteWeight> edge = BuildEdge(bus, i, j);
-                route_time += ComputeTime(bus, j - 1, j);
-                edge.weight.total_time = route_time;
-                graph_.AddEdge(edge);
+                graph_.AddEdge(BuildEdge(bus, i, j));
 
                 if (!bus->circular) {
-                    int i_back = stops_count - 1 - i;
-                    int j_back = stops_count - 1 - j;
-                    
-                    graph::Edge<RouteWeight> edge = BuildEdge(bus, i_back, j_back);
-                    
-                    route_time_back += ComputeTime(bus, j_back + 1, j_back);
-                    edge.weight.total_time = route_time_back;
-                    graph_.AddEdge(edge);
+                    graph_.AddEdge(BuildEdge(bus, stops_count - 1 - i, stops_count - 1 - j));
                 }
             }
         }
     }
 }
 
+void TransportRouter::BuildTransferEdges() {
+    size_t vertex_count = catalogue_.GetStopsSize();
+
+    for (const transport::Bus& bus : catalogue_.GetBuses()) {
+        vertex_count += bus.bus_stops.size() * (bus.circular ? 1 : 2);
+    }
+
+    graph_ = Graph(vertex_count);
+    vertex_stop_ids_.resize(vertex_count);
+
+    for (int id = 0; id < catalogue_.GetStopsSize(); ++id) {
+        vertex_stop_ids_[id] = id;
+    }
+
+    // Посадка возможна на всех остановках цепочки, кроме её последней; из вершины
+    // «в автобусе» выходят перегон (кроме последней) и высадка (кроме первой)
+    std::vector<size_t> out_degrees(vertex_count);
+    graph::VertexId first_vertex = catalogue_.GetStopsSize();
+
+    for (const transport::Bus& bus : catalogue_.GetBuses()) {
+        const size_t stops_count = bus.bus_stops.size();
+        const size_t chains_count = bus.circular ? 1 : 2;
+
+        for (size_t i = 0; i < stops_count; ++i) {
+            out_degrees[bus.bus_stops[i]->id] += (i + 1 < stops_count ? 1 : 0)
+                + (!bus.circular && i > 0 ? 1 : 0);
+        }
+
+        for (size_t i = 0; i < stops_count * chains_count; ++i) {
+            const size_t position = i % stops_count;
+            out_degrees[first_vertex + i] = (position + 1 < stops_count ? 1 : 0) + (position > 0 ? 1 : 0);
+        }
+
+        first_vertex += stops_count * chains_count;
+    }
+
+    graph_.ReserveEdges(out_degrees);
+    first_vertex = catalogue_.GetStopsSize();
+
+    for (const transport::Bus& bus_item : catalogue_.GetBuses()) {
+        const transport::Bus* bus = &bus_item;
+        BuildTransferChain(bus, false, first_vertex);
+        first_vertex += bus->bus_stops.size();
+
+        if (!bus->circular) {
+            BuildTransferChain(bus, true, first_vertex);
+            first_vertex += bus->bus_stops.size();
+        }
+    }
+}
+
+// Цепочка вершин «в автобусе на i-й остановке маршрута»: посадка стоит bus_wait_time,
+// перегон до следующей остановки — время в пути, высадка бесплатна
+void TransportRouter::BuildTransferChain(const transport::Bus* bus, bool backward, graph::VertexId first_vertex) {
+    int stops_count = static_cast<int>(bus->bus_stops.size());
+
+    auto stop_index = [backward, stops_count](int position) {
+        return backward ? stops_count - 1 - position : position;
+    };
+
+    for (int i = 0; i < stops_count; ++i) {
+        const graph::VertexId ride_vertex = first_vertex + i;
+        const graph::VertexId stop_vertex = bus->bus_stops[stop_index(i)]->id;
+
+        vertex_stop_ids_[ride_vertex] = static_cast<int>(stop_vertex);
+
+        if (i + 1 < stops_count) {
+            graph_.AddEdge({stop_vertex, ride_vertex,
+                RouteWeight{bus->name, static_cast<double>(settings_.bus_wait_time), 0}});
+            graph_.AddEdge({ride_vertex, ride_vertex + 1,
+                RouteWeight{bus->name, ComputeTime(bus, stop_index(i), stop_index(i + 1)), 1}});
+        }
+
+        if (i > 0) {
+            graph_.AddEdge({ride_vertex, stop_vertex, RouteWeight{bus->name, 0, 0}});
+        }
+    }
+}
+
 graph::Edge<RouteWeight> TransportRouter::BuildEdge(const transport::Bus* bus,
     int stop_from_index, int stop_to_index) {
 
     graph::Edge<RouteWeight> edge;
     
-    edge.from = catalogue_.GetStopId(bus->bus_stops.at(static_cast<size_t>(stop_from_index))->name);
-    edge.to = catalogue_.GetStopId(bus->bus_stops.at(static_cast<size_t>(stop_to_index))->name);
+    edge.from = bus->bus_stops.at(static_cast<size_t>(stop_from_index))->id;
+    edge.to = bus->bus_stops.at(static_cast<size_t>(stop_to_index))->id;
     
     edge.weight.bus_name = bus->name;
-    edge.weight.span_count = static_cast<int>(stop_to_index - stop_from_index);
+    edge.weight.span_count = std::abs(stop_to_index - stop_from_index);
+    edge.weight.total_time = settings_.bus_wait_time + ComputeTime(bus, stop_from_index, stop_to_index);
     
     return edge;
 }
 
 double TransportRouter::ComputeTime(const transport::Bus* bus, int stop_from_index, int stop_to_index) {
-    auto distance = catalogue_.GetStopsDistance(bus->bus_stops.at(static_cast<size_t>(stop_from_index))->name,
-        bus->bus_stops.at(static_cast<size_t>(stop_to_index))->name);
+    auto distance = catalogue_.GetBusDistance(bus->id, static_cast<size_t>(stop_from_index),
+        static_cast<size_t>(stop_to_index));
     
     return distance / (settings_.bus_velocity * 1000.0 / 60.0);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
 #include "graph.h"
 #include "router.h"
 #include "transport_catalogue.h"
@@ -23,20 +25,70 @@ struct RouteWeight {
 	int span_count = 0;
 };
 
+// ALL_PAIRS — предвычисленная при make_base матрица кратчайших путей V×V,
+// DIJKSTRA — поиск по графу на каждый запрос, без матрицы,
+// CONTRACTION_HIERARCHY — иерархия сжатий, строится при make_base
+enum class RouterMode {
+	ALL_PAIRS,
+	DIJKSTRA,
+	CONTRACTION_HIERARCHY,
+};
+
+// STOP_PAIRS — вершины только остановки, ребро на каждую пару остановок одного автобуса;
+// TRANSFER — кроме вершин ожидания на остановках есть вершины «в автобусе на остановке»,
+// число рёбер растёт линейно от длины маршрута
+enum class GraphModel {
+	STOP_PAIRS,
+	TRANSFER,
+};
+
 struct RouteSettings {
 	int bus_wait_time = 0;
 	int bus_velocity = 0;
+	RouterMode mode = RouterMode::ALL_PAIRS;
+	GraphModel graph_model = GraphModel::STOP_PAIRS;
+	// Для маршрутов между точками: скорость пешехода в км/ч
+	// и насколько далеко от точки искать остановки, в метрах
+	double walk_velocity = 5;
+	double max_walk_distance = 1000;
 };
 
+// Остановка, до которой (или от которой) идут пешком walk_time минут
+struct WalkStop {
+	transport::StopId stop_id;
+	double walk_time;
+};
+
+// Остановка, до которой можно доехать за time минут
+struct ReachedStop {
+	transport::StopId stop_id;
+	double time;
+};
+
+std::vector<graph::Terminal<RouteWeight>> MakeTerminals(const std::vector<WalkStop>& walk_stops);
+
 bool operator<(const RouteWeight& left, const RouteWeight& right);
 bool operator>(const RouteWeight& left, const RouteWeight& right);
 RouteWeight operator+(const RouteWeight& left, const RouteWeight& right);
 
+} // namespace route
+
+template <>
+struct graph::WeightTraits<route::RouteWeight> {
+    static double ToScalar(const route::RouteWeight& weight) {
+        return weight.total_time;
+    }
+};
+
+namespace route {
+
 class TransportRouter {
 public:
 
     using Graph = graph::DirectedWeightedGraph<RouteWeight>;
     using Router = graph::Router<RouteWeight>;
+    using DijkstraRouter = graph::DijkstraRouter<RouteWeight>;
+    using ContractionHierarchy = graph::ContractionHierarchy<RouteWeight>;
 
     struct RouterEdge {
         std::string bus_name;
@@ -47,35 +99,135 @@ public:
     };
     using TransportRoute = std::vector<RouterEdge>;
 
+    // Ячейка матрицы маршрутов; rides заполняются, только если нужны пути
+    struct RouteTime {
+        double total_time = 0;
+        TransportRoute rides;
+    };
+
+    // Маршрут между точками: пешком до from_stop, поездки, пешком от to_stop.
+    // total_time включает обе пешие части
+    struct WalkRoute {
+        transport::StopId from_stop;
+        transport::StopId to_stop;
+        double total_time = 0;
+        TransportRoute rides;
+    };
+
     TransportRouter(const transport::TransportCatalogue& catalogue,
         const RouteSettings& settings);
 
     std::optional<TransportRoute> BuildRoute(const std::string& from, const std::string& to);
+    // Один проход Дейкстры от всех sources сразу до ближайшей из targets
+    std::optional<WalkRoute> BuildRoute(const std::vector<WalkStop>& sources,
+        const std::vector<WalkStop>& targets);
+    // Строка матрицы маршрутов: один поиск от from до всех to
+    std::vector<std::optional<RouteTime>> BuildRoutes(transport::StopId from,
+        const std::vector<transport::StopId>& to, bool with_rides);
+
+    // Остановки, до которых от from можно доехать не дольше чем за max_time минут,
+    // по возрастанию времени; from тоже входит, со временем 0
+    std::vector<ReachedStop> FindReachableStops(transport::StopId from, double max_time);
 
     const RouteSettings& GetSettings() const;
     RouteSettings& GetSettings();
 
+    // Число потоков для построения матрицы ALL_PAIRS, 0 — по числу ядер
+    void SetThreadsCount(size_t threads_count);
+    // Печатать в cerr время построения графа
+    void SetReportStats(bool report_stats);
+
+    // Строит граф и предвычисленные данные выбранного режима, если их ещё нет
     void InitRouter();
+    // Строит только граф, не трогая данные режима
+    void BuildGraph();
+    // Строит граф, если его нет, и Дейкстру над ним: её хватает маршрутам между
+    // точками, строкам матрицы и изохронам, матрица ALL_PAIRS для них не нужна
+    void InitDijkstraRouter();
+    bool IsInitialized() const;
+    bool IsGraphInitialized() const;
+
     void InternalInit();
+    void InternalGraphInit();
 
     Graph& GetGraph();
     const Graph& GetGraph() const;
 
+    std::vector<int>& GetVertexStopIds();
+    const std::vector<int>& GetVertexStopIds() const;
+
     std::unique_ptr<Router>& GetRouter();
     const std::unique_ptr<Router>& GetRouter() const;
+
+    std::unique_ptr<ContractionHierarchy>& GetContractionHierarchy();
+    const std::unique_ptr<ContractionHierarchy>& GetContractionHierarchy() const;
 private:
 
     bool is_initialized_ = false;
+    bool is_graph_initialized_ = false;
+    size_t threads_count_ = 1;
+    bool report_stats_ = false;
 
     const transport::TransportCatalogue &catalogue_;
     RouteSettings settings_;
 
     Graph graph_;
+    // Остановка, к которой относится вершина графа: первые GetStopsSize() вершин —
+    // сами остановки, остальные (в модели TRANSFER) — «в автобусе на остановке»
+    std::vector<int> vertex_stop_ids_;
     mutable std::unique_ptr<Router> router_;
+    std::unique_ptr<DijkstraRouter> dijkstra_router_;
+    std::unique_ptr<ContractionHierarchy> contraction_hierarchy_;
 
+    TransportRoute MakeRides(const std::vector<graph::EdgeId>& edges) const;
     void BuildEdges();
+    void BuildTransferEdges();
+    void BuildTransferChain(const transport::Bus* bus, bool backward, graph::VertexId first_vertex);
+    std::optional<std::vector<graph::EdgeId>> FindRouteEdges(graph::VertexId from, graph::VertexId to) const;
     graph::Edge<RouteWeight> BuildEdge(const transport::Bus* bus, int stop_from_index, int stop_to_index);
     double ComputeTime(const transport::Bus* bus, int stop_from_index, int stop_to_index);
 };
 
-} 
\ No newline at end of file
+// Собирает из рёбер найденного маршрута поездки для ответа. В модели TRANSFER
+// поездка — цепочка «посадка, перегоны, высадка», она сворачивается в одно ребро,
+// как в модели STOP_PAIRS. Вершины меньше stops_count — остановки,
+// vertex_stop_ids переводит вершину в номер остановки, stop_name(id) возвращает
+// название остановки по номеру — из справочника или из образа mapped
+template <typename Graph, typename StopName>
+TransportRouter::TransportRoute MakeTransportRoute(const Graph& graph, const int* vertex_stop_ids,
+    size_t stops_count, const std::vector<graph::EdgeId>& edges, StopName stop_name) {
+
+    auto vertex_stop_name = [vertex_stop_ids, &stop_name](graph::VertexId vertex) {
+        return std::string(stop_name(static_cast<transport::StopId>(vertex_stop_ids[vertex])));
+    };
+
+    TransportRouter::TransportRoute result;
+    TransportRouter::RouterEdge route_edge;
+
+    for (auto edge_id : edges) {
+        const auto& edge = graph.GetEdge(edge_id);
+
+        if (edge.from < stops_count) {
+            route_edge = TransportRouter::RouterEdge{};
+            route_edge.bus_name = edge.weight.bus_name;
+            route_edge.stop_from = vertex_stop_name(edge.from);
+        }
+
+        route_edge.span_count += edge.weight.span_count;
+        route_edge.total_time += edge.weight.total_time;
+
+        if (edge.to < stops_count) {
+            route_edge.stop_to = vertex_stop_name(edge.to);
+            result.push_back(route_edge);
+        }
+    }
+
+    return result;
+}
+
+// Оставляет из найденных вершин только остановки: вершины от stops_count
+// и дальше в модели TRANSFER означают «в автобусе», а не прибытие на остановку
+std::vector<ReachedStop> MakeReachedStops(
+    const std::vector<std::pair<graph::VertexId, RouteWeight>>& reachable, size_t stops_count);
+
+} 